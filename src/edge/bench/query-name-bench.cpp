@@ -0,0 +1,240 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+// Time the edge takes to read a query from an Interest name and name the
+// Interests it forwards, before and after QueryName. The legacy functions
+// are those QueryName replaced, as the cloud-mode path called them, less
+// their logging to std::cerr, which would dominate either side.
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+
+#include <ndn-cxx/name.hpp>
+
+#include "query-name.hpp"
+
+namespace {
+const size_t num_queries = 20000;
+
+namespace legacy {
+std::string decodeURI(const std::string &uri)
+{
+  std::string replaced_string(uri);
+
+  boost::algorithm::replace_all(replaced_string, "%23", "#");
+  boost::algorithm::replace_all(replaced_string, "%3A", ":");
+  boost::algorithm::replace_all(replaced_string, "%2C", ",");
+  boost::algorithm::replace_all(replaced_string, "%5B", "[");
+  boost::algorithm::replace_all(replaced_string, "%5D", "]");
+  boost::algorithm::replace_all(replaced_string, "%20", " ");
+  boost::algorithm::replace_all(replaced_string, "%27", "'");
+  boost::algorithm::replace_all(replaced_string, "%28", "(");
+  boost::algorithm::replace_all(replaced_string, "%29", ")");
+  boost::algorithm::replace_all(replaced_string, "%2A", "*");
+
+  return replaced_string;
+}
+
+void convertInterestName(const std::string &interest_name,
+                         std::vector<std::string> &interest_name_list)
+{
+  std::vector<std::string> token_list;
+  boost::algorithm::split(token_list, interest_name, boost::is_any_of("/"));
+
+  std::string keyword(token_list.back());
+  token_list.pop_back();
+
+  std::string function_name(token_list.back());
+  token_list.pop_back();
+  std::string routable_prefix(boost::algorithm::join(token_list, "/"));
+
+  std::vector<std::string> key_list;
+  boost::algorithm::split(key_list, keyword, boost::is_any_of(" "));
+  std::string target(key_list.back());
+  key_list.pop_back();
+  std::string location_key(key_list.back());
+
+  std::vector<std::string> lockey_list;
+  boost::algorithm::split(lockey_list, location_key, boost::is_any_of(":"));
+  std::string location(lockey_list.back());
+  boost::algorithm::replace_all(location, "[", "");
+  boost::algorithm::replace_all(location, "]", "");
+
+  std::vector<std::string> location_list;
+  boost::algorithm::split(location_list, location, boost::is_any_of(","));
+
+  std::vector<std::string> location_name_list;
+  for(unsigned int i = 0; i < location_list.size(); i++) {
+    std::vector<std::string> tmp;
+
+    for(unsigned int j = 0; j < location_list[i].size(); j += 1) {
+      tmp.push_back(location_list[i].substr(j, 1));
+    }
+    std::string location_name("/" + boost::algorithm::join(tmp, "/"));
+
+    location_name_list.push_back(location_name);
+  };
+
+  for(unsigned int i = 0; i < location_name_list.size(); i++) {
+    std::string name(location_name_list[i] + "/" + function_name + "/" + "#a:[" +
+                     location_list[i] + "] " + target);
+    interest_name_list.push_back(name);
+  }
+  return;
+}
+
+std::vector<std::string> ExtractTargets(const std::string &interest_name)
+{
+  std::vector<std::string> token_list;
+  boost::algorithm::split(token_list, interest_name, boost::is_any_of("/"));
+
+  std::string keyword(token_list.back());
+  std::vector<std::string> key_list;
+  boost::algorithm::split(key_list, keyword, boost::is_any_of(" "));
+
+  std::string material(key_list.back());
+  std::vector<std::string> material_list;
+  boost::algorithm::split(material_list, material, boost::is_any_of(":"));
+
+  std::string target(material_list.back());
+  boost::algorithm::replace_all(target, "[", "");
+  boost::algorithm::replace_all(target, "]", "");
+
+  std::vector<std::string> target_list;
+  boost::algorithm::split(target_list, target, boost::is_any_of(","));
+
+  return target_list;
+}
+
+std::vector<std::string> ExtractLocname(const std::string &interest_name)
+{
+  std::vector<std::string> token_list;
+  boost::algorithm::split(token_list, interest_name, boost::is_any_of("/"));
+
+  token_list.pop_back();
+  std::string keyword(token_list.back());
+  token_list.pop_back();
+
+  std::string function_name(token_list.back());
+  token_list.pop_back();
+  std::string routable_prefix(boost::algorithm::join(token_list, "/"));
+
+  std::vector<std::string> key_list;
+  boost::algorithm::split(key_list, keyword, boost::is_any_of(" "));
+  std::string target(key_list.back());
+  key_list.pop_back();
+  std::string location_key(key_list.back());
+
+  std::vector<std::string> lockey_list;
+  boost::algorithm::split(lockey_list, location_key, boost::is_any_of(":"));
+  std::string location(lockey_list.back());
+  boost::algorithm::replace_all(location, "[", "");
+  boost::algorithm::replace_all(location, "]", "");
+
+  std::vector<std::string> loc_list;
+  boost::algorithm::split(loc_list, location, boost::is_any_of(","));
+
+  return loc_list;
+}
+}  // namespace legacy
+
+// Returns the number of Interests named, so that the work is not optimized away.
+size_t before(const ndn::Name &name, uint64_t session_id)
+{
+  std::vector<std::string> target_name = legacy::ExtractTargets(legacy::decodeURI(name.toUri()));
+  std::string interest_name(legacy::decodeURI(name.toUri()));
+  std::vector<std::string> reinvoked_name;
+  legacy::convertInterestName(interest_name, reinvoked_name);
+
+  size_t count = target_name.size();
+  for(const std::string &reinvoked : reinvoked_name) {
+    ndn::Name re_name(reinvoked + "/" + std::to_string(session_id));
+    std::vector<std::string> location_name =
+        legacy::ExtractLocname(reinvoked + "/" + std::to_string(session_id));
+    count += re_name.size() + location_name[0].size();
+  }
+  return count;
+}
+
+size_t after(const ndn::Name &name, uint64_t session_id)
+{
+  Query query;
+  if(!QueryName::parse(name, false, query)) {
+    return 0;
+  }
+  std::vector<std::string> target_name = Query::to_strings(query.targets);
+
+  size_t count = target_name.size();
+  for(const boost::string_view &location : query.locations) {
+    ndn::Name re_name(QueryName::forward(query.function, location, session_id));
+    std::string location_name(location.data(), location.size());
+    count += re_name.size() + location_name.size();
+  }
+  return count;
+}
+
+template <class F>
+double measure(const ndn::Name &name, F parse, size_t &count)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < num_queries; ++i) {
+    count += parse(name, i);
+  }
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start)
+             .count() /
+         num_queries;
+}
+}  // namespace
+
+int main()
+{
+  boost::format row_format("%1%:%|16t|%2$.2f us before%|36t|%3$.2f us after");
+  std::cerr << "query-name-bench: " << num_queries << " queries" << std::endl;
+
+  size_t count = 0;
+  for(const size_t num_locations : {1, 4, 16}) {
+    std::string locations;
+    for(size_t i = 0; i < num_locations; ++i) {
+      locations += (i > 0 ? "," : "") + std::to_string(30300 + i % 4 + (i / 4) * 10);
+    }
+    ndn::Name name("/icn2020/edge");
+    name.append("#f:detect");
+    name.append("#a:[" + locations + "] #a:[person,car,bicycle]");
+
+    const double before_us = measure(name, before, count);
+    const double after_us = measure(name, after, count);
+    std::cerr << row_format % (std::to_string(num_locations) + " locations") % before_us %
+                     after_us
+              << std::endl;
+  }
+  return (count > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,183 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+// Time a cloud-mode frame takes to arrive with the old constant window of
+// one segment and with the adaptive window, over a link of a given RTT
+// that drops a share of the Data. The worker side answers on a
+// DummyClientFace, which loops the fetcher's Interests back to it; it holds
+// every segment back for an RTT and drops the lost ones, as an emulated
+// link would.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/format.hpp>
+
+#include <ndn-cxx/data.hpp>
+#include <ndn-cxx/interest-filter.hpp>
+#include <ndn-cxx/name.hpp>
+#include <ndn-cxx/security/key-chain.hpp>
+#include <ndn-cxx/security/signing-helpers.hpp>
+#include <ndn-cxx/security/validator-null.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+#include <ndn-cxx/util/segment-fetcher.hpp>
+
+namespace {
+// A raw 416x416 BGR frame in segments of the worker's default size
+const size_t frame_size = 416 * 416 * 3;
+const size_t segment_size = 8000;
+const size_t num_runs = 3;
+
+struct Result {
+  double transfer_ms = 0;
+  size_t timeouts = 0;
+  bool is_complete = false;
+};
+
+std::vector<std::shared_ptr<ndn::Data>> make_segments(const ndn::Name &versioned_prefix,
+                                                      ndn::KeyChain &key_chain)
+{
+  std::vector<uint8_t> frame(frame_size);
+  for(size_t i = 0; i < frame.size(); ++i) {
+    frame[i] = static_cast<uint8_t>(i * 7);
+  }
+  std::vector<std::shared_ptr<ndn::Data>> segments;
+  const size_t num_segments = (frame_size + segment_size - 1) / segment_size;
+  for(size_t i = 0; i < num_segments; ++i) {
+    std::shared_ptr<ndn::Data> data =
+        std::make_shared<ndn::Data>(ndn::Name(versioned_prefix).appendSegment(i));
+    data->setFreshnessPeriod(ndn::time::seconds(10));
+    data->setContent(frame.data() + i * segment_size,
+                     std::min(segment_size, frame_size - i * segment_size));
+    data->setFinalBlock(ndn::name::Component::fromSegment(num_segments - 1));
+    key_chain.sign(*data, ndn::security::signingWithSha256());
+    data->wireEncode();
+    segments.push_back(data);
+  }
+  return segments;
+}
+
+Result fetch(const std::vector<std::shared_ptr<ndn::Data>> &segments,
+             const ndn::util::SegmentFetcher::Options &options, std::chrono::milliseconds rtt,
+             double loss, std::mt19937 &random)
+{
+  boost::asio::io_service io;
+  ndn::util::DummyClientFace face(io);
+  std::bernoulli_distribution is_lost(loss);
+
+  ndn::InterestFilter filter("/bench/frame");
+  filter.allowLoopback(true);
+  face.setInterestFilter(filter, [&](const ndn::InterestFilter &, const ndn::Interest &interest) {
+    const ndn::Name &name = interest.getName();
+    const size_t segment = name[-1].isSegment() ? name[-1].toSegment() : 0;
+    if(segment >= segments.size() || is_lost(random)) {
+      return;
+    }
+    std::shared_ptr<boost::asio::steady_timer> timer(new boost::asio::steady_timer(io));
+    timer->expires_from_now(rtt);
+    const std::shared_ptr<ndn::Data> data = segments[segment];
+    timer->async_wait([&face, timer, data](const boost::system::error_code &error) {
+      if(!error) {
+        face.put(*data);
+      }
+    });
+  });
+
+  ndn::Interest interest("/bench/frame");
+  interest.setCanBePrefix(true);
+  interest.setMustBeFresh(true);
+
+  Result result;
+  bool is_done = false;
+  const auto start = std::chrono::steady_clock::now();
+  auto fetcher = ndn::util::SegmentFetcher::start(
+      face, interest, ndn::security::v2::getAcceptAllValidator(), options);
+  fetcher->afterSegmentTimedOut.connect([&result] { ++result.timeouts; });
+  fetcher->onComplete.connect([&](ndn::ConstBufferPtr data) {
+    result.transfer_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+            .count();
+    result.is_complete = data->size() == frame_size;
+    is_done = true;
+  });
+  fetcher->onError.connect([&](uint32_t code, const std::string &message) {
+    std::cerr << "Fetch error " << code << ": " << message << std::endl;
+    is_done = true;
+  });
+  // Segments still on their way are dropped along with io.
+  while(!is_done && io.run_one() != 0) {
+  }
+  return result;
+}
+}  // namespace
+
+int main()
+{
+  ndn::KeyChain key_chain("pib-memory:", "tpm-memory:");
+  const std::vector<std::shared_ptr<ndn::Data>> segments =
+      make_segments(ndn::Name("/bench/frame").appendVersion(1), key_chain);
+
+  // The window Producer used before, and the one it uses by default now
+  ndn::util::SegmentFetcher::Options constant;
+  constant.useConstantCwnd = true;
+  constant.initCwnd = 1;
+  ndn::util::SegmentFetcher::Options adaptive;
+
+  std::mt19937 random(1);
+  boost::format row_format("%1% ms, %2$.0f%% loss:%|20t|%3%%|32t|%4$.1f ms%|46t|%5$.1f timeouts");
+  std::cerr << "segment-fetch-bench: " << frame_size << " bytes in " << segments.size()
+            << " segments, mean of " << num_runs << " fetches" << std::endl;
+  for(const int rtt_ms : {5, 20, 50}) {
+    for(const double loss : {0.0, 0.01, 0.05}) {
+      for(const bool is_adaptive : {false, true}) {
+        double transfer_ms = 0;
+        size_t timeouts = 0;
+        for(size_t run = 0; run < num_runs; ++run) {
+          const Result result = fetch(segments, is_adaptive ? adaptive : constant,
+                                      std::chrono::milliseconds(rtt_ms), loss, random);
+          if(!result.is_complete) {
+            std::cerr << "FAILED: fetch did not complete" << std::endl;
+            return EXIT_FAILURE;
+          }
+          transfer_ms += result.transfer_ms;
+          timeouts += result.timeouts;
+        }
+        std::cerr << row_format % rtt_ms % (loss * 100) % (is_adaptive ? "adaptive" : "constant") %
+                         (transfer_ms / num_runs) % (double(timeouts) / num_runs)
+                  << std::endl;
+      }
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+// Throughput of SessionManager against the number of threads answering the
+// same queries. Every query is opened with one answer expected from each
+// thread, and all threads append to every query, so that both the shard
+// locks and the session locks are contended. The thread that completes a
+// query releases it, as Producer::on_answer() does; each query has to be
+// completed exactly once.
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/format.hpp>
+
+#include <ndn-cxx/data.hpp>
+
+#include "session-manager.hpp"
+
+namespace {
+const size_t num_sessions = 20000;
+
+// Returns the number of queries completed.
+size_t run(boost::asio::io_service &io, size_t num_threads, uint64_t first_id, double &elapsed_ms)
+{
+  SessionManager &manager = SessionManager::instance();
+  for(size_t i = 0; i < num_sessions; ++i) {
+    std::shared_ptr<boost::asio::steady_timer> timer(new boost::asio::steady_timer(io));
+    timer->expires_from_now(std::chrono::seconds(10));
+    manager.add(first_id + i, std::make_shared<ndn::Data>(), timer, num_threads);
+  }
+
+  const std::string payload(
+      "{\"isFound\":true,\"location\":\"30321\",\"session_id\":\"1\",\"target\":\"person\"}");
+  std::atomic<size_t> completed(0);
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+  for(size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&manager, &payload, &completed, first_id, t] {
+      // Threads walk the queries from different starting points, like the
+      // answers of different workers arriving in different orders.
+      for(size_t i = 0; i < num_sessions; ++i) {
+        const uint64_t id = first_id + (i + t * num_sessions / 8) % num_sessions;
+        const SessionManager::status status = manager.append_payload(
+            id, reinterpret_cast<const uint8_t *>(payload.data()), payload.size());
+        if(status == SessionManager::status::complete && manager.release(id) != nullptr) {
+          ++completed;
+        }
+      }
+    });
+  }
+  for(std::thread &thread : threads) {
+    thread.join();
+  }
+  elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                   .count();
+  return completed;
+}
+}  // namespace
+
+int main()
+{
+  boost::asio::io_service io;
+  boost::format row_format("%1%:%|10t|%2$.1f ms%|24t|%3$.0f answers/s");
+  std::cerr << "session-manager-bench: " << num_sessions << " queries, "
+            << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+  uint64_t first_id = 1;
+  int failures = 0;
+  for(const size_t num_threads : {1, 2, 4, 8}) {
+    double elapsed_ms = 0.0;
+    const size_t completed = run(io, num_threads, first_id, elapsed_ms);
+    first_id += num_sessions;
+    std::cerr << row_format % num_threads % elapsed_ms %
+                     (num_sessions * num_threads / elapsed_ms * 1000.0)
+              << std::endl;
+    if(completed != num_sessions || SessionManager::instance().size() != 0) {
+      std::cerr << "FAILED: " << completed << " of " << num_sessions << " queries completed, "
+                << SessionManager::instance().size() << " left" << std::endl;
+      ++failures;
+    }
+  }
+  return (failures != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+// Time ThreadPool takes to run the parsing of queries against its number of
+// threads. Every task reads the query of an Interest name and names the
+// Interests it forwards, as Producer::processInterest does before any I/O,
+// and the tasks are posted from the main thread, as the face thread posts
+// them; with 0 threads tasks run on the posting thread.
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <thread>
+
+#include <boost/format.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <ndn-cxx/name.hpp>
+
+#include "query-name.hpp"
+#include "thread-pool.hpp"
+
+namespace {
+const size_t num_tasks = 50000;
+
+// Returns the number of components named, so that the work is not optimized away.
+size_t process(const ndn::Name &name, uint64_t session_id)
+{
+  Query query;
+  if(!QueryName::parse(name, false, query)) {
+    return 0;
+  }
+  size_t count = 0;
+  for(const boost::string_view &location : query.locations) {
+    count += QueryName::forward(query.function, location, session_id).size();
+  }
+  return count;
+}
+
+double run(const ndn::Name &name, size_t num_threads, size_t &count)
+{
+  // Declared before the pool, which joins its threads before they go.
+  std::atomic<size_t> done(0);
+  std::atomic<size_t> named(0);
+  std::promise<void> all_done;
+  ThreadPool pool(num_threads);
+  const auto start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < num_tasks; ++i) {
+    pool.post([&name, i, &done, &named, &all_done] {
+      named += process(name, i);
+      if(done.fetch_add(1) + 1 == num_tasks) {
+        all_done.set_value();
+      }
+    });
+  }
+  all_done.get_future().wait();
+  count += named;
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+}  // namespace
+
+int main()
+{
+  ndn::Name name("/icn2020/edge");
+  name.append("#f:detect");
+  name.append("#a:[30300,30301,30302,30303] #a:[person,car,bicycle]");
+
+  boost::format row_format("%1%:%|10t|%2$.1f ms%|24t|%3$.0f tasks/s");
+  std::cerr << "thread-pool-bench: " << num_tasks << " queries of 4 locations, "
+            << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+  size_t count = 0;
+  for(const size_t num_threads : {0, 1, 2, 4, 8}) {
+    const double elapsed_ms = run(name, num_threads, count);
+    std::cerr << row_format % num_threads % elapsed_ms % (num_tasks / elapsed_ms * 1000.0)
+              << std::endl;
+  }
+  return (count > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+// Time DnnObjectDetection::postprocess spends on a frame, before and after
+// YoloPostprocess. The outputs are shaped as those of YOLOv3 at 416x416,
+// 10647 rows of 85 columns over three layers, with a few clusters of
+// overlapping boxes among rows of low objectness. Before, every row had its
+// class scores searched with minMaxLoc and NMS ran across all classes.
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+
+#include "yolo-postprocess.hpp"
+
+namespace {
+const cv::Size frame_size(416, 416);
+const int num_classes = 80;
+const int num_objects = 8;
+const float conf_threshold = 0.5;
+const float nms_threshold = 0.4;
+const size_t num_frames = 200;
+
+// Rows of the three region layers, of 13x13, 26x26 and 52x52 cells with
+// three anchors each.
+std::vector<cv::Mat> make_outs(cv::RNG &rng)
+{
+  std::vector<cv::Mat> outs;
+  for(const int grid : {13, 26, 52}) {
+    cv::Mat out(grid * grid * 3, 5 + num_classes, CV_32F);
+    for(int j = 0; j < out.rows; ++j) {
+      float *data = out.ptr<float>(j);
+      const int object = rng.uniform(0, num_objects * 50);
+      if(object < num_objects) {
+        // A box around one of the objects, whose class scores, scaled by
+        // objectness as the region layer does, favour the object's class.
+        const float objectness = rng.uniform(0.5f, 1.0f);
+        data[0] = (object + 0.5f) / num_objects + rng.uniform(-0.01f, 0.01f);
+        data[1] = 0.5f + rng.uniform(-0.01f, 0.01f);
+        data[2] = 0.1f + rng.uniform(-0.01f, 0.01f);
+        data[3] = 0.2f + rng.uniform(-0.01f, 0.01f);
+        data[4] = objectness;
+        for(int c = 0; c < num_classes; ++c) {
+          data[5 + c] = objectness * rng.uniform(0.0f, 0.05f);
+        }
+        data[5 + object % 4] = objectness * rng.uniform(0.8f, 1.0f);
+      } else {
+        const float objectness = rng.uniform(0.0f, 0.01f);
+        data[0] = rng.uniform(0.0f, 1.0f);
+        data[1] = rng.uniform(0.0f, 1.0f);
+        data[2] = rng.uniform(0.0f, 0.5f);
+        data[3] = rng.uniform(0.0f, 0.5f);
+        data[4] = objectness;
+        for(int c = 0; c < num_classes; ++c) {
+          data[5 + c] = objectness * rng.uniform(0.0f, 1.0f);
+        }
+      }
+    }
+    outs.push_back(out);
+  }
+  return outs;
+}
+
+// The loop YoloPostprocess replaced. Returns the number of candidates.
+size_t before(const std::vector<cv::Mat> &outs, std::vector<int> &indices)
+{
+  std::vector<int> classIds;
+  std::vector<float> confidences;
+  std::vector<cv::Rect> boxes;
+
+  for(size_t i = 0; i < outs.size(); ++i) {
+    float *data = (float *) outs[i].data;
+    for(int j = 0; j < outs[i].rows; ++j, data += outs[i].cols) {
+      cv::Mat scores = outs[i].row(j).colRange(5, outs[i].cols);
+      cv::Point classIdPoint;
+      double confidence;
+      minMaxLoc(scores, 0, &confidence, 0, &classIdPoint);
+      if(confidence > conf_threshold) {
+        int centerX = (int) (data[0] * frame_size.width);
+        int centerY = (int) (data[1] * frame_size.height);
+        int width = (int) (data[2] * frame_size.width);
+        int height = (int) (data[3] * frame_size.height);
+        int left = centerX - width / 2;
+        int top = centerY - height / 2;
+
+        classIds.push_back(classIdPoint.x);
+        confidences.push_back((float) confidence);
+        boxes.push_back(cv::Rect(left, top, width, height));
+      }
+    }
+  }
+
+  cv::dnn::NMSBoxes(boxes, confidences, conf_threshold, nms_threshold, indices);
+  return boxes.size();
+}
+
+size_t after(const std::vector<cv::Mat> &outs, std::vector<int> &indices)
+{
+  YoloPostprocess::Candidates candidates;
+  for(size_t i = 0; i < outs.size(); ++i) {
+    YoloPostprocess::scan(outs[i], conf_threshold, frame_size, candidates);
+  }
+  YoloPostprocess::suppress(candidates, conf_threshold, nms_threshold, indices);
+  return candidates.boxes.size();
+}
+
+template <class F> double run(F f, const std::vector<cv::Mat> &outs, size_t &candidates,
+                              size_t &objects)
+{
+  std::vector<int> indices;
+  const auto start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < num_frames; ++i) {
+    indices.clear();
+    candidates = f(outs, indices);
+  }
+  objects = indices.size();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+             .count() /
+         num_frames;
+}
+}  // namespace
+
+int main()
+{
+  cv::RNG rng(1);
+  const std::vector<cv::Mat> outs = make_outs(rng);
+  int num_rows = 0;
+  for(const cv::Mat &out : outs) {
+    num_rows += out.rows;
+  }
+
+  boost::format row_format("%1%:%|10t|%2$.3f ms per frame%|32t|%3% candidates into %4% objects");
+  std::cerr << "yolo-postprocess-bench: " << num_rows << " rows of " << 5 + num_classes
+            << " columns, " << num_frames << " frames" << std::endl;
+  size_t candidates = 0, objects = 0;
+  const double before_ms = run(before, outs, candidates, objects);
+  std::cerr << row_format % "before" % before_ms % candidates % objects << std::endl;
+  const double after_ms = run(after, outs, candidates, objects);
+  std::cerr << row_format % "after" % after_ms % candidates % objects << std::endl;
+  return EXIT_SUCCESS;
+}
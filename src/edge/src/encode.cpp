@@ -38,3 +38,18 @@ std::string Encoder::encode(const std::string &location_str, const std::string &
                                                {"session_id", session_id_str}};
   return json_obj.dump();
 }
+
+std::string Encoder::encode(const std::string &location_str, const std::string &time_str,
+                            const std::vector<std::string> &target_list,
+                            const std::vector<bool> &found_list,
+                            const std::string session_id_str)
+{
+  std::string result;
+  for(size_t i = 0; i < target_list.size() && i < found_list.size(); ++i) {
+    if(i > 0) {
+      result += '\n';
+    }
+    result += encode(location_str, time_str, target_list[i], found_list[i], session_id_str);
+  }
+  return result;
+}
@@ -28,6 +28,7 @@
 #define ENCODE_HPP_INC
 
 #include <string>
+#include <vector>
 
 class Encoder {
  public:
@@ -35,6 +36,11 @@ class Encoder {
   static std::string encode(const std::string &location_str, const std::string &time_str,
                             const std::string &target_str, bool is_found,
                             const std::string session_id_str);
+  // One line per target, in the same format as above, separated by '\n'.
+  static std::string encode(const std::string &location_str, const std::string &time_str,
+                            const std::vector<std::string> &target_list,
+                            const std::vector<bool> &found_list,
+                            const std::string session_id_str);
 };
 
 #endif
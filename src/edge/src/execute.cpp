@@ -29,66 +29,144 @@
 #include <string>
 #include <algorithm>
 
+#include <boost/algorithm/string/join.hpp>
+
 #include "execute.hpp"
 #include "encode.hpp"
+#include "frame-codec.hpp"
 
 #include <ndn-cxx/encoding/tlv.hpp>
 #include <ndn-cxx/encoding/block.hpp>
 #include <ndn-cxx/encoding/buffer.hpp>
 
-Executor::Executor(std::string prefix, std::string location, std::string target,
-                   std::string session_id, detector_ptr detector, Producer *producer)
+Executor::Executor(std::string prefix, std::string location, std::vector<std::string> targets,
+                   uint64_t session_id, batcher_ptr batcher, Producer *producer)
     : m_fetcher_name(prefix),
       m_location_name(location),
-      m_target_name(target),
+      m_target_names(std::move(targets)),
       m_session_id(session_id),
-      m_detector(detector),
-      m_producer(producer)
+      m_batcher(batcher),
+      m_producer(producer),
+      m_fetch_start(),
+      m_segments(0),
+      m_timeouts(0),
+      m_nacks(0)
 {
 }
 
 Executor::~Executor() {}
 
+void Executor::afterFetchStart()
+{
+  m_fetch_start = std::chrono::steady_clock::now();
+}
+
+void Executor::afterSegmentReceived(const ndn::Data& data)
+{
+  ++m_segments;
+}
+
+void Executor::afterSegmentTimedOut()
+{
+  ++m_timeouts;
+}
+
+void Executor::afterSegmentNacked()
+{
+  ++m_nacks;
+}
+
 void Executor::afterFetchComplete(const ndn::ConstBufferPtr& data)
 {
   // object detection process and the same process as onData
-  std::cerr << "got data " << std::endl;
+  const double transfer_ms = std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - m_fetch_start)
+                                 .count();
+  std::cerr << "[INFO] Fetched " << data->size() << " bytes from " << m_fetcher_name << " in "
+            << transfer_ms << " ms (" << m_segments << " segments, " << m_timeouts
+            << " timeouts, " << m_nacks << " nacks)" << std::endl;
 
-  const ndn::Block wire(ndn::tlv::AppPrivateBlock1, data);
-  // const ndn::Block wire(UINT8_WIDTH, data);
-  const size_t length = wire.value_size();
-  const uint8_t* value_ptr = wire.value();
-  const std::vector<uint8_t> value(&value_ptr[0], &value_ptr[length]);
-  cv::Mat raw(value);
-  raw = raw.reshape(3, 480);  // should be change rows automatically
+  FrameHeader header;
+  if(!header.decode(data->data(), data->size())) {
+    std::cerr << "[WARN] Invalid frame header from " << m_fetcher_name << std::endl;
+    m_producer->addfailure(m_session_id);
+    return;
+  }
+  const uint8_t* payload = data->data() + FrameHeader::size;
+  const size_t payload_size = data->size() - FrameHeader::size;
+
+  cv::Mat raw;
+  if(header.codec == FrameCodec::RAW) {
+    // Wrap the fetched buffer in place; |data| outlives |raw| in this scope.
+    const size_t expected = static_cast<size_t>(header.rows) * header.cols *
+                            CV_ELEM_SIZE(static_cast<int>(header.type));
+    if(header.rows > 0 && header.cols > 0 && payload_size == expected) {
+      raw = cv::Mat(static_cast<int>(header.rows), static_cast<int>(header.cols),
+                    static_cast<int>(header.type), const_cast<uint8_t*>(payload));
+    }
+  } else {
+    const auto decode_start = std::chrono::steady_clock::now();
+    raw = FrameCodec::decode(payload, payload_size);
+    const double decode_ms = std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - decode_start)
+                                 .count();
+    if(raw.rows != static_cast<int>(header.rows) || raw.cols != static_cast<int>(header.cols)) {
+      raw.release();
+    } else {
+      const size_t raw_size = raw.total() * raw.elemSize();
+      std::cerr << "[INFO] Decoded " << FrameCodec::to_string(header.codec) << " frame "
+                << raw.cols << "x" << raw.rows << " in " << decode_ms << " ms (" << payload_size
+                << " of " << raw_size << " bytes transferred, saving about "
+                << transfer_ms * (static_cast<double>(raw_size) / payload_size - 1.0)
+                << " ms of transfer)" << std::endl;
+    }
+  }
+  if(raw.empty()) {
+    std::cerr << "[WARN] Malformed " << FrameCodec::to_string(header.codec) << " frame ("
+              << header.cols << "x" << header.rows << ", " << payload_size << " bytes) from "
+              << m_fetcher_name << std::endl;
+    m_producer->addfailure(m_session_id);
+    return;
+  }
 
-  std::vector<std::string> detection_result;
-  m_detector->detect(raw, detection_result);
+  // |data| is kept alive until detection, since a raw frame refers to it.
+  // Boxes found in a letterboxed frame are mapped back to the camera frame.
+  auto self = shared_from_this();
+  m_batcher->submit(m_location_name, raw,
+                    [self, data, header](std::vector<Detection>& detection_result) {
+                      for(Detection& detection : detection_result) {
+                        detection.box = header.to_source(detection.box);
+                      }
+                      self->afterDetection(detection_result);
+                    });
+}
 
-  std::cerr << "Specified target: [" << m_target_name << "]" << std::endl;
+void Executor::afterDetection(const std::vector<Detection>& detection_result)
+{
+  std::cerr << "Specified targets: [" << boost::algorithm::join(m_target_names, ",") << "]"
+            << std::endl;
   std::cerr << "List of detected objects: [" << std::endl;
-  for(const std::string& line : detection_result) {
-    std::cerr << line << std::endl;
+  for(const Detection& detection : detection_result) {
+    std::cerr << m_batcher->detector().classNames()[detection.class_id] << std::endl;
   }
   std::cerr << "]" << std::endl;
 
-  bool is_found = false;
-  if(std::find(detection_result.begin(), detection_result.end(), m_target_name) != detection_result.end()) {
-    std::cout << "------------------------------------" << std::endl;
-    std::cout << "----------[Target Found!]-----------" << std::endl;
-    std::cout << "------------------------------------" << std::endl;
-    is_found = true;
-  } else {
-    std::cout << "------------------------------------" << std::endl;
-    std::cout << "--------[Target Not Found!]---------" << std::endl;
-    std::cout << "------------------------------------" << std::endl;
-    is_found = false;
+  // Every requested target is answered from the same detection pass.
+  std::vector<bool> found_list;
+  found_list.reserve(m_target_names.size());
+  for(const std::string& target : m_target_names) {
+    const bool is_found = m_batcher->detector().contains(detection_result, target);
+    std::cout << "[" << target << "] " << (is_found ? "Target Found!" : "Target Not Found!")
+              << std::endl;
+    found_list.push_back(is_found);
   }
-  std::string result_str = Encoder::encode(m_location_name, "", m_target_name, is_found, m_session_id);
-  m_producer->adddata(result_str);
+  std::string result_str = Encoder::encode(m_location_name, "", m_target_names, found_list,
+                                           std::to_string(m_session_id));
+  m_producer->adddata(m_session_id, result_str);
 }
 
 void Executor::afterFetchError(uint32_t errorCode, const std::string& ErrorMsg)
 {
   std::cerr << errorCode << " " << ErrorMsg << std::endl;
+  m_producer->addfailure(m_session_id);
 }
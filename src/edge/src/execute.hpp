@@ -27,27 +27,47 @@
 #ifndef EXECUTOR_HPP_INC
 #define EXECUTOR_HPP_INC
 
-#include "objectdetection.hpp"
+#include "inference-batcher.hpp"
 #include "producer.hpp"
 
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ndn-cxx/data.hpp>
 #include <ndn-cxx/encoding/buffer.hpp>
 
-class Executor {
+class Executor : public std::enable_shared_from_this<Executor> {
  public:
-  Executor(std::string prefix, std::string location, std::string target,
-           std::string session_id, detector_ptr detector, Producer* producer);
+  Executor(std::string prefix, std::string location, std::vector<std::string> targets,
+           uint64_t session_id, batcher_ptr batcher, Producer* producer);
   ~Executor();
 
+  // Transfer statistics; called on the face thread while the frame is fetched.
+  void afterFetchStart();
+  void afterSegmentReceived(const ndn::Data& data);
+  void afterSegmentTimedOut();
+  void afterSegmentNacked();
+
   void afterFetchComplete(const ndn::ConstBufferPtr& data);
   void afterFetchError(uint32_t errorCode, const std::string& ErrorMsg);
 
+ private:
+  void afterDetection(const std::vector<Detection>& detection_result);
+
  private:
   const std::string  m_fetcher_name;
   const std::string  m_location_name;
-  const std::string  m_target_name;
-  const std::string  m_session_id;
-  detector_ptr m_detector;
+  const std::vector<std::string> m_target_names;
+  const uint64_t     m_session_id;
+  batcher_ptr  m_batcher;
   Producer*    m_producer;
+
+  std::chrono::steady_clock::time_point m_fetch_start;
+  size_t m_segments;
+  size_t m_timeouts;
+  size_t m_nacks;
 };
 
 #endif
@@ -0,0 +1,260 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#include "frame-codec.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+constexpr size_t FrameHeader::size;
+constexpr uint8_t FrameHeader::version;
+
+namespace {
+void put_be(uint8_t *data, uint64_t value, size_t bytes)
+{
+  for(size_t i = 0; i < bytes; ++i) {
+    data[i] = static_cast<uint8_t>(value >> (8 * (bytes - 1 - i)));
+  }
+}
+
+uint64_t get_be(const uint8_t *data, size_t bytes)
+{
+  uint64_t value = 0;
+  for(size_t i = 0; i < bytes; ++i) {
+    value = (value << 8) | data[i];
+  }
+  return value;
+}
+}  // namespace
+
+void FrameHeader::encode(uint8_t *data) const
+{
+  uint32_t scale_bits;
+  static_assert(sizeof(scale_bits) == sizeof(scale), "float is not 32 bits");
+  std::memcpy(&scale_bits, &scale, sizeof(scale_bits));
+
+  put_be(data, version, 1);
+  put_be(data + 1, codec, 1);
+  put_be(data + 2, 0, 2);
+  put_be(data + 4, rows, 4);
+  put_be(data + 8, cols, 4);
+  put_be(data + 12, type, 4);
+  put_be(data + 16, timestamp, 8);
+  put_be(data + 24, source_rows, 4);
+  put_be(data + 28, source_cols, 4);
+  put_be(data + 32, scale_bits, 4);
+  put_be(data + 36, pad_x, 2);
+  put_be(data + 38, pad_y, 2);
+}
+
+bool FrameHeader::decode(const uint8_t *data, size_t length)
+{
+  if(length < size || data[0] != version) {
+    return false;
+  }
+  codec = data[1];
+  rows = static_cast<uint32_t>(get_be(data + 4, 4));
+  cols = static_cast<uint32_t>(get_be(data + 8, 4));
+  type = static_cast<uint32_t>(get_be(data + 12, 4));
+  timestamp = get_be(data + 16, 8);
+  source_rows = static_cast<uint32_t>(get_be(data + 24, 4));
+  source_cols = static_cast<uint32_t>(get_be(data + 28, 4));
+  const uint32_t scale_bits = static_cast<uint32_t>(get_be(data + 32, 4));
+  std::memcpy(&scale, &scale_bits, sizeof(scale));
+  pad_x = static_cast<uint16_t>(get_be(data + 36, 2));
+  pad_y = static_cast<uint16_t>(get_be(data + 38, 2));
+  return scale > 0.0f;
+}
+
+cv::Rect FrameHeader::to_source(const cv::Rect &box) const
+{
+  const cv::Rect source(0, 0, static_cast<int>(source_cols), static_cast<int>(source_rows));
+  const int left = static_cast<int>(std::lround((box.x - pad_x) / scale));
+  const int top = static_cast<int>(std::lround((box.y - pad_y) / scale));
+  const int right = static_cast<int>(std::lround((box.x + box.width - pad_x) / scale));
+  const int bottom = static_cast<int>(std::lround((box.y + box.height - pad_y) / scale));
+  return cv::Rect(left, top, right - left, bottom - top) & source;
+}
+
+cv::Mat FrameCodec::letterbox(const cv::Mat &frame, const cv::Size &size, FrameHeader &header)
+{
+  header.source_rows = frame.rows;
+  header.source_cols = frame.cols;
+  header.scale = 1.0f;
+  header.pad_x = 0;
+  header.pad_y = 0;
+  if(size.width <= 0 || size.height <= 0 ||
+     (frame.cols <= size.width && frame.rows <= size.height)) {
+    return frame;
+  }
+
+  const float scale = std::min(static_cast<float>(size.width) / frame.cols,
+                               static_cast<float>(size.height) / frame.rows);
+  const cv::Size scaled(std::max(1, static_cast<int>(std::lround(frame.cols * scale))),
+                        std::max(1, static_cast<int>(std::lround(frame.rows * scale))));
+  header.scale = scale;
+  header.pad_x = static_cast<uint16_t>((size.width - scaled.width) / 2);
+  header.pad_y = static_cast<uint16_t>((size.height - scaled.height) / 2);
+
+  // Same grey as the padding of Darknet's letterbox, so the network sees
+  // what it was trained on.
+  cv::Mat canvas(size, frame.type(), cv::Scalar::all(127));
+  cv::Mat content = canvas(cv::Rect(cv::Point(header.pad_x, header.pad_y), scaled));
+  cv::resize(frame, content, scaled, 0, 0, cv::INTER_AREA);
+  return canvas;
+}
+
+uint8_t FrameCodec::encode(const cv::Mat &frame, const FrameRequest &request,
+                           std::vector<uint8_t> &buffer)
+{
+  const int quality = std::min<int>(request.quality, 100);
+  std::vector<int> params;
+  const char *ext = nullptr;
+  switch(request.codec) {
+    case JPEG:
+      ext = ".jpg";
+      params = {cv::IMWRITE_JPEG_QUALITY, quality};
+      break;
+    case PNG:
+      ext = ".png";
+      params = {cv::IMWRITE_PNG_COMPRESSION, quality / 10};
+      break;
+    case WEBP:
+      ext = ".webp";
+      params = {cv::IMWRITE_WEBP_QUALITY, std::max(quality, 1)};
+      break;
+    default:
+      break;
+  }
+
+  if(ext != nullptr) {
+    try {
+      std::vector<uint8_t> encoded;
+      if(cv::imencode(ext, frame, encoded, params)) {
+        buffer.insert(buffer.end(), encoded.begin(), encoded.end());
+        return request.codec;
+      }
+    } catch(const cv::Exception &e) {
+      std::cerr << "[WARN] Cannot encode a frame as " << ext << ": " << e.what() << std::endl;
+    }
+  }
+
+  const cv::Mat flat = frame.isContinuous() ? frame : frame.clone();
+  buffer.insert(buffer.end(), flat.data, flat.data + flat.total() * flat.elemSize());
+  return RAW;
+}
+
+cv::Mat FrameCodec::decode(const uint8_t *data, size_t length)
+{
+  if(length == 0) {
+    return cv::Mat();
+  }
+  // imdecode() recognizes the format by its signature and does not modify its input.
+  const cv::Mat encoded(1, static_cast<int>(length), CV_8UC1, const_cast<uint8_t *>(data));
+  try {
+    return cv::imdecode(encoded, cv::IMREAD_COLOR);
+  } catch(const cv::Exception &e) {
+    return cv::Mat();
+  }
+}
+
+bool FrameCodec::from_string(const std::string &str, uint8_t &codec)
+{
+  if(str == "raw") {
+    codec = RAW;
+  } else if(str == "jpeg" || str == "jpg") {
+    codec = JPEG;
+  } else if(str == "png") {
+    codec = PNG;
+  } else if(str == "webp") {
+    codec = WEBP;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *FrameCodec::to_string(uint8_t codec)
+{
+  switch(codec) {
+    case RAW:
+      return "raw";
+    case JPEG:
+      return "jpeg";
+    case PNG:
+      return "png";
+    case WEBP:
+      return "webp";
+    default:
+      return "unknown";
+  }
+}
+
+std::string FrameCodec::request_key(const FrameRequest &request)
+{
+  std::string key =
+      std::string("#c:") + to_string(request.codec) + "," + std::to_string(request.quality);
+  if(request.width > 0 && request.height > 0) {
+    key += "," + std::to_string(request.width) + "x" + std::to_string(request.height);
+  }
+  return key;
+}
+
+bool FrameCodec::parse_request_key(const std::string &key, FrameRequest &request)
+{
+  if(key.compare(0, 3, "#c:") != 0) {
+    return false;
+  }
+  std::istringstream fields(key.substr(3));
+  std::string codec;
+  unsigned int quality;
+  if(!std::getline(fields, codec, ',') || !from_string(codec, request.codec) ||
+     !(fields >> quality) || quality > 100) {
+    return false;
+  }
+  request.quality = static_cast<uint8_t>(quality);
+
+  unsigned int width, height;
+  char comma, times;
+  request.width = 0;
+  request.height = 0;
+  if(fields.peek() == std::char_traits<char>::eof()) {
+    return true;
+  }
+  if(!(fields >> comma >> width >> times >> height) || comma != ',' || times != 'x' ||
+     width > UINT16_MAX || height > UINT16_MAX) {
+    return false;
+  }
+  request.width = static_cast<uint16_t>(width);
+  request.height = static_cast<uint16_t>(height);
+  return true;
+}
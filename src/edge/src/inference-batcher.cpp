@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#include "inference-batcher.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+constexpr size_t InferenceBatcher::scene_capacity;
+
+InferenceBatcher::InferenceBatcher(detector_ptr detector, size_t max_batch,
+                                   std::chrono::milliseconds window, int change_threshold)
+    : m_detector(detector),
+      m_max_batch(std::max<size_t>(1, max_batch)),
+      m_window(window),
+      m_scene_gate(change_threshold, scene_capacity),
+      m_run(true),
+      m_batches(0),
+      m_frames(0)
+{
+  if(m_max_batch > 1) {
+    m_thread = std::thread([this] { this->run(); });
+  }
+}
+
+InferenceBatcher::~InferenceBatcher()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_run = false;
+  }
+  m_cond.notify_all();
+  if(m_thread.joinable()) m_thread.join();
+}
+
+void InferenceBatcher::submit(const std::string& scene, cv::Mat frame, callback_type callback)
+{
+  if(m_max_batch == 1) {
+    std::vector<Request> batch(1);
+    batch[0].scene = scene;
+    batch[0].frame = frame;
+    batch[0].callback = std::move(callback);
+    // Without the batcher lock, so that callbacks may submit frames and
+    // frames of other threads are not held up behind them. The detector
+    // serializes forward passes itself.
+    process(batch);
+    return;
+  }
+
+  bool is_first;
+  bool is_full;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    is_first = m_requests.empty();
+    m_requests.push_back(Request{scene, frame, std::move(callback)});
+    is_full = m_requests.size() >= m_max_batch;
+  }
+  if(is_first || is_full) {
+    m_cond.notify_one();
+  }
+}
+
+void InferenceBatcher::run()
+{
+  std::vector<Request> batch;
+  while(true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this] { return !m_run || !m_requests.empty(); });
+      if(m_requests.empty()) {
+        return;
+      }
+      // Give other locations of the same query the window to join the batch.
+      const auto deadline = std::chrono::steady_clock::now() + m_window;
+      m_cond.wait_until(lock, deadline,
+                        [this] { return !m_run || m_requests.size() >= m_max_batch; });
+
+      const size_t count = std::min(m_requests.size(), m_max_batch);
+      batch.clear();
+      std::move(m_requests.begin(), m_requests.begin() + count, std::back_inserter(batch));
+      m_requests.erase(m_requests.begin(), m_requests.begin() + count);
+    }
+    try {
+      process(batch);
+    } catch(const std::exception& e) {
+      // The sessions of the frames time out; later batches may still succeed.
+      std::cerr << "[WARN] Detection of a batch failed: " << e.what() << std::endl;
+    }
+  }
+}
+
+void InferenceBatcher::process(std::vector<Request>& batch)
+{
+  // Frames of unchanged scenes take the remembered detections; only the
+  // others go through the network.
+  std::vector<std::vector<Detection>> results(batch.size());
+  std::vector<SceneChangeGate::Signature> signatures(batch.size());
+  std::vector<cv::Mat> frames;
+  std::vector<size_t> frame_index;
+  frames.reserve(batch.size());
+  for(size_t i = 0; i < batch.size(); ++i) {
+    if(!m_scene_gate.lookup(batch[i].scene, batch[i].frame, signatures[i], results[i])) {
+      frames.push_back(batch[i].frame);
+      frame_index.push_back(i);
+    }
+  }
+
+  if(!frames.empty()) {
+    const auto detect_start = std::chrono::steady_clock::now();
+    std::vector<std::vector<Detection>> detected;
+    m_detector->detect(frames, detected);
+    const double detect_ms = std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - detect_start)
+                                 .count();
+    detected.resize(frames.size());
+    for(size_t n = 0; n < frames.size(); ++n) {
+      const size_t i = frame_index[n];
+      results[i] = std::move(detected[n]);
+      m_scene_gate.update(batch[i].scene, std::move(signatures[i]), results[i]);
+    }
+
+    const uint64_t batches = ++m_batches;
+    const uint64_t total_frames = m_frames += frames.size();
+    std::cerr << "[INFO] Detected a batch of " << frames.size() << " frames in " << detect_ms
+              << " ms (" << detect_ms / frames.size() << " ms per frame, " << total_frames
+              << " frames in " << batches << " batches so far)" << std::endl;
+  }
+  if(m_scene_gate.isEnabled()) {
+    std::cerr << "[INFO] Scene change gate: " << batch.size() - frames.size() << " of "
+              << batch.size() << " frames unchanged (" << m_scene_gate.hits() << " unchanged, "
+              << m_scene_gate.misses() << " changed so far)" << std::endl;
+  }
+
+  for(size_t i = 0; i < batch.size(); ++i) {
+    batch[i].callback(results[i]);
+  }
+}
@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#ifndef INFERENCE_BATCHER_HPP_INC
+#define INFERENCE_BATCHER_HPP_INC
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "objectdetection.hpp"
+
+using batcher_ptr = std::shared_ptr<class InferenceBatcher>;
+
+// Collects frames submitted from several threads and runs them through the
+// detector as one batch.
+//
+// A batch is closed when it holds max_batch frames or when window has passed
+// since its first frame arrived, whichever comes first. Detection and the
+// callbacks run on the batcher's own thread, which is the only thread that
+// touches the network. With max_batch of 1, submit() detects on the calling
+// thread and no batcher thread is started; the detector then serializes the
+// forward passes of concurrent callers.
+//
+// With a change_threshold above 0, frames of a scene that has not changed
+// since its last detected frame take the detections of that frame instead,
+// see SceneChangeGate.
+class InferenceBatcher : boost::noncopyable {
+ public:
+  using callback_type = std::function<void(std::vector<Detection>& result)>;
+
+  // Scenes remembered by the scene change gate, i.e. cameras of the edge
+  static constexpr size_t scene_capacity = 256;
+
+  InferenceBatcher(detector_ptr detector, size_t max_batch, std::chrono::milliseconds window,
+                   int change_threshold);
+  ~InferenceBatcher();
+
+  bool isReady() const { return m_detector->isReady(); }
+  // See ObjectDetection::waitReady().
+  void waitReady() { m_detector->waitReady(); }
+  const ObjectDetection& detector() const { return *m_detector; }
+  // scene names where frame was taken, e.g. the location of the camera.
+  void submit(const std::string& scene, cv::Mat frame, callback_type callback);
+
+  uint64_t batches() const { return m_batches; }
+  uint64_t frames() const { return m_frames; }
+
+ private:
+  struct Request {
+    std::string scene;
+    cv::Mat frame;
+    callback_type callback;
+  };
+
+  void run();
+  void process(std::vector<Request>& batch);
+
+ private:
+  detector_ptr m_detector;
+  const size_t m_max_batch;
+  const std::chrono::milliseconds m_window;
+  SceneChangeGate m_scene_gate;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::vector<Request> m_requests;
+  bool m_run;
+
+  std::atomic<uint64_t> m_batches;
+  std::atomic<uint64_t> m_frames;
+
+  std::thread m_thread;
+};
+
+#endif
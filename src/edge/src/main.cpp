@@ -25,31 +25,85 @@
  *
  */
 #include <exception>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "inference-batcher.hpp"
 #include "objectdetection.hpp"
+#include "parameter.hpp"
 #include "producer.hpp"
 
 int main(int argc, char** argv)
 {
-  if(argc < 2) {
-    fprintf(stderr, "Usage: %s option[-c | -e]\n", argv[0]);
-    return 1;
-  }
-
-  int c = getopt(argc, argv, "ce");
-  if((c != 'c') && (c != 'e')) {
-    fprintf(stderr, "Usage: %s option[-c | -e]\n", argv[0]);
-    return 2;
-  }
+  Parameter::instance().parse(argc, argv);
+  std::cerr << Parameter::instance();
 
   try {
-    detector_ptr detector;
-    std::string dummy_file;
-    detector = detector_ptr(new DnnObjectDetection(dummy_file));
-    Producer producer(c, detector);
+    ndn::util::SegmentFetcher::Options fetch_options;
+    fetch_options.useConstantCwnd = !Parameter::instance().is_adaptive_fetch();
+    fetch_options.initCwnd = Parameter::instance().init_cwnd();
+    fetch_options.interestLifetime = ndn::time::milliseconds(Parameter::instance().interest_lifetime());
+    fetch_options.maxTimeout = ndn::time::milliseconds(Parameter::instance().max_timeout());
+
+    FrameRequest frame_request;
+    frame_request.codec = Parameter::instance().codec();
+    frame_request.quality = Parameter::instance().quality();
+    if(Parameter::instance().is_letterbox_mode()) {
+      // The network scales every frame to its input size anyway.
+      frame_request.width = static_cast<uint16_t>(Parameter::instance().input_size());
+      frame_request.height = static_cast<uint16_t>(Parameter::instance().input_size());
+    }
+
+    // Only cloud mode runs inference on the edge; in edge mode the workers do.
+    batcher_ptr batcher;
+    if(Parameter::instance().mode() == 'c') {
+      DetectorConfig detector_config;
+      detector_config.model = Parameter::instance().model();
+      detector_config.config = Parameter::instance().model_config();
+      detector_config.classes = Parameter::instance().classes_file();
+      detector_config.backend = Parameter::instance().backend();
+      detector_config.precision = Parameter::instance().precision();
+      detector_config.input_width = Parameter::instance().input_size();
+      detector_config.input_height = Parameter::instance().input_size();
+      detector_config.annotate = Parameter::instance().is_annotate_mode();
+      detector_config.snapshot_dir = Parameter::instance().snapshot_dir();
+      detector_config.snapshot_rate = Parameter::instance().snapshot_rate();
+
+      std::string dummy_file;
+      detector_ptr detector(new DnnObjectDetection(detector_config, dummy_file));
+      batcher = std::make_shared<InferenceBatcher>(
+          detector, Parameter::instance().batch_size(),
+          std::chrono::milliseconds(Parameter::instance().batch_window()),
+          Parameter::instance().change_threshold());
+    }
+
+    // Query descriptors name their targets by index into the classes file.
+    std::vector<std::string> class_names;
+    std::ifstream ifs(Parameter::instance().classes_file().c_str());
+    if(!ifs) {
+      throw std::runtime_error("cannot open the classes file " +
+                               Parameter::instance().classes_file());
+    }
+    std::string line;
+    while(std::getline(ifs, line)) class_names.push_back(line);
+    if(class_names.empty()) {
+      throw std::runtime_error("no classes in " + Parameter::instance().classes_file());
+    }
+
+    RegionScope scope;
+    scope.region = Parameter::instance().region();
+    scope.cells = Parameter::instance().cells();
+    scope.max_fanout = Parameter::instance().max_fanout();
+
+    Producer producer(Parameter::instance().mode(), Parameter::instance().num_threads(),
+                      fetch_options, frame_request, std::move(class_names), std::move(scope),
+                      batcher);
     producer.run();
   } catch(const std::exception& e) {
     std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
   }
   return 0;
 }
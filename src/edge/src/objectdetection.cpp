@@ -25,62 +25,173 @@
  *
  */
 #include "objectdetection.hpp"
+#include "yolo-postprocess.hpp"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <ctime>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <random>
+#include <stdexcept>
 
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/videoio.hpp>
 
-EmulateObjectDetection::EmulateObjectDetection() : ObjectDetection(), m_classes(0)
+void ObjectDetection::detect(const std::vector<cv::Mat>& frames,
+                             std::vector<std::vector<Detection>>& results)
+{
+  results.resize(frames.size());
+  for(size_t i = 0; i < frames.size(); ++i) {
+    detect(frames[i], results[i]);
+  }
+}
+
+bool ObjectDetection::contains(const std::vector<Detection>& detections,
+                               const std::string& class_name) const
+{
+  const std::vector<std::string>& names = classNames();
+  return std::any_of(detections.begin(), detections.end(), [&](const Detection& detection) {
+    return names[detection.class_id] == class_name;
+  });
+}
+
+SceneChangeGate::SceneChangeGate(int threshold, size_t capacity)
+    : m_threshold(threshold), m_capacity(std::max<size_t>(capacity, 1)), m_hits(0), m_misses(0)
+{}
+
+bool SceneChangeGate::lookup(const std::string& scene, const cv::Mat& frame,
+                             Signature& signature, std::vector<Detection>& result)
+{
+  if(!isEnabled() || frame.empty()) {
+    return false;
+  }
+
+  // Shrink first, so the colour conversion touches 1024 pixels only.
+  cv::Mat small;
+  cv::resize(frame, small, cv::Size(32, 32), 0, 0, cv::INTER_AREA);
+  if(small.channels() == 3) {
+    cv::cvtColor(small, signature.thumbnail, cv::COLOR_BGR2GRAY);
+  } else if(small.channels() == 4) {
+    cv::cvtColor(small, signature.thumbnail, cv::COLOR_BGRA2GRAY);
+  } else {
+    signature.thumbnail = small;
+  }
+  signature.frame_size = frame.size();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = std::find_if(m_entries.begin(), m_entries.end(),
+                         [&scene](const Entry& entry) { return entry.scene == scene; });
+  if(it != m_entries.end() && it->signature.frame_size == signature.frame_size &&
+     it->signature.thumbnail.type() == signature.thumbnail.type() &&
+     cv::norm(it->signature.thumbnail, signature.thumbnail, cv::NORM_INF) <= m_threshold) {
+    ++m_hits;
+    result.insert(result.end(), it->detections.begin(), it->detections.end());
+    // Keep the scenes that are still being looked at.
+    std::rotate(m_entries.begin(), it, it + 1);
+    return true;
+  }
+  ++m_misses;
+  return false;
+}
+
+void SceneChangeGate::update(const std::string& scene, Signature&& signature,
+                             const std::vector<Detection>& detections)
+{
+  if(!isEnabled() || signature.thumbnail.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = std::find_if(m_entries.begin(), m_entries.end(),
+                         [&scene](const Entry& entry) { return entry.scene == scene; });
+  if(it != m_entries.end()) {
+    m_entries.erase(it);
+  }
+  m_entries.push_front(Entry{scene, std::move(signature), detections});
+  if(m_entries.size() > m_capacity) {
+    m_entries.pop_back();
+  }
+}
+
+EmulateObjectDetection::EmulateObjectDetection() : ObjectDetection(), m_classes(0), m_candidates(0)
 {
   const std::string classesFile = "./config/coco.names";
   std::ifstream ifs(classesFile.c_str());
 
   std::string line;
   while(std::getline(ifs, line)) {
-    if(line.compare("person") != 0) m_classes.push_back(line);
+    if(line.compare("person") != 0) m_candidates.push_back(static_cast<int>(m_classes.size()));
+    m_classes.push_back(line);
   }
 }
 
-void EmulateObjectDetection::detect(cv::Mat frame, std::vector<std::string>& result)
+void EmulateObjectDetection::detect(cv::Mat frame, std::vector<Detection>& result)
 {
   std::random_device rand_dev;
   std::mt19937 engine(rand_dev());
 
-  std::shuffle(m_classes.begin(), m_classes.end(), engine);
-  std::copy_n(m_classes.begin(), 10, std::back_inserter(result));
+  std::shuffle(m_candidates.begin(), m_candidates.end(), engine);
+  for(size_t i = 0; i < 10 && i < m_candidates.size(); ++i) {
+    result.push_back(Detection{m_candidates[i], 1.0f, cv::Rect()});
+  }
 
   return;
 }
 
-DnnObjectDetection::DnnObjectDetection(const std::string& dummy_file)
+namespace {
+// Loads the network of config on its backend and target, falling back to
+// the OpenCV backend on the CPU when the requested pair is unavailable.
+cv::dnn::Net loadNet(const DetectorConfig& config)
+{
+  cv::dnn::Net net = cv::dnn::readNet(config.model, config.config);
+
+  const cv::dnn::Backend backend = (config.backend == "inference-engine")
+                                       ? cv::dnn::DNN_BACKEND_INFERENCE_ENGINE
+                                       : cv::dnn::DNN_BACKEND_OPENCV;
+  // The OpenCV CPU path has no half precision; FP16 runs through OpenCL,
+  // which itself falls back to the CPU when no device is present.
+  const cv::dnn::Target target =
+      (config.precision == "fp16") ? cv::dnn::DNN_TARGET_OPENCL_FP16 : cv::dnn::DNN_TARGET_CPU;
+
+  const auto available = cv::dnn::getAvailableBackends();
+  if(std::find(available.begin(), available.end(), std::make_pair(backend, target)) !=
+     available.end()) {
+    net.setPreferableBackend(backend);
+    net.setPreferableTarget(target);
+  } else {
+    std::cerr << "[WARN] DNN backend " << config.backend << " with " << config.precision
+              << " is not available, using opencv with fp32" << std::endl;
+    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+  }
+  return net;
+}
+}  // namespace
+
+DnnObjectDetection::DnnObjectDetection(const DetectorConfig& config, const std::string& dummy_file)
     : ObjectDetection(),
+      m_input_width(config.input_width),
+      m_input_height(config.input_height),
+      m_config(config),
       m_dummy_file(dummy_file),
       m_is_dummy_mode(!dummy_file.empty()),
-      m_is_verbose(false)
+      m_is_verbose(config.annotate),
+      m_snapshot_writer(config.snapshot_dir, config.snapshot_rate),
+      m_run(false),
+      m_ready(false)
 {
   // Load names of classes
-  const std::string classesFile = "./config/coco.names";
-  // Give the configuration and weight files for the model
-  const cv::String modelConfiguration = "./config/yolov3.cfg";
-  const cv::String modelWeights = "./config/yolov3.weights";
-
-  std::ifstream ifs(classesFile.c_str());
+  std::ifstream ifs(config.classes.c_str());
 
   std::string line;
   while(std::getline(ifs, line)) m_classes.push_back(line);
 
-  // Load the network
-  m_net = cv::dnn::readNetFromDarknet(modelConfiguration, modelWeights);
-  m_net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-  m_net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+  // Load the network in the background, so that the face can come up and
+  // answer Interests while the weights are parsed.
+  m_loader = std::thread([this]() { this->load(); });
 
   /* if(m_is_dummy_mode == false) {  // ダミーを使う
     int device_id = 0;
@@ -97,12 +208,58 @@ DnnObjectDetection::DnnObjectDetection(const std::string& dummy_file)
 }
 DnnObjectDetection::~DnnObjectDetection()
 {
+  if(m_loader.joinable()) {
+    m_loader.join();
+  }
   if(m_run == true) {
     m_run = false;
     m_thread.join();
   }
 }
 
+void DnnObjectDetection::load()
+{
+  try {
+    const auto load_start = std::chrono::steady_clock::now();
+    m_net = loadNet(m_config);
+    const double load_ms = std::chrono::duration<double, std::milli>(
+                               std::chrono::steady_clock::now() - load_start)
+                               .count();
+    // The measured pass comes after a warm-up pass, so the first real frame
+    // does not pay for the layer allocation.
+    const double latency_ms = measureLatency();
+    std::cerr << "[INFO] Loaded model " << m_config.model << " (" << m_config.input_width << "x"
+              << m_config.input_height << ", " << m_config.backend << ", " << m_config.precision
+              << ") in " << load_ms << " ms: " << latency_ms << " ms per frame" << std::endl;
+  } catch(const std::exception& e) {
+    // The thread that waits for the model reports it.
+    std::lock_guard<std::mutex> lock(m_ready_mutex);
+    m_load_error = std::string("cannot load model ") + m_config.model + ": " + e.what();
+    m_ready_cond.notify_all();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_ready_mutex);
+    m_ready.store(true, std::memory_order_release);
+  }
+  m_ready_cond.notify_all();
+}
+
+void DnnObjectDetection::waitReady()
+{
+  if(m_ready.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(m_ready_mutex);
+  m_ready_cond.wait(lock, [this] {
+    return m_ready.load(std::memory_order_acquire) || !m_load_error.empty();
+  });
+  if(!m_load_error.empty()) {
+    throw std::runtime_error(m_load_error);
+  }
+}
+
 void DnnObjectDetection::capture()
 {
   while(m_run) {
@@ -123,11 +280,13 @@ void DnnObjectDetection::capture()
   return;
 }
 
-void DnnObjectDetection::detect(cv::Mat frame, std::vector<std::string>& result)
+void DnnObjectDetection::detect(cv::Mat frame, std::vector<Detection>& result)
 {
-  std::string str;
   cv::Mat blob;
-  std::cerr << " in func " << std::endl;
+
+  waitReady();
+  // cv::dnn::Net is not reentrant; detect() is called from several pool threads.
+  std::lock_guard<std::mutex> lock(m_mutex);
 
   /* {
     std::lock_guard<std::mutex> lock(m_mutex);
@@ -138,8 +297,6 @@ void DnnObjectDetection::detect(cv::Mat frame, std::vector<std::string>& result)
   cv::dnn::blobFromImage(frame, blob, 1 / 255.0, cvSize(m_input_width, m_input_height), cv::Scalar(0, 0, 0),
                          true, false);
 
-  std::cerr << " in blob " << std::endl;
-
   // Sets the input to the network
   m_net.setInput(blob);
 
@@ -148,9 +305,14 @@ void DnnObjectDetection::detect(cv::Mat frame, std::vector<std::string>& result)
   m_net.forward(outs, getOutputsNames());
 
   // Remove the bounding boxes with low confidence
-  postprocess(frame, outs, result);
+  const size_t first = result.size();
+  postprocess(frame.size(), outs, result);
+
+  if(m_is_verbose && m_snapshot_writer.isDue()) {
+    // frame may share its buffer with the fetched Data; draw on a copy.
+    frame = frame.clone();
+    annotate(frame, std::vector<Detection>(result.begin() + first, result.end()));
 
-  if(m_is_verbose) {
     // Put efficiency information. The function getPerfProfile returns the overall time for
     // inference(t) and the timings for each of the layers(in layersTimes)
     std::vector<double> layersTimes;
@@ -163,56 +325,85 @@ void DnnObjectDetection::detect(cv::Mat frame, std::vector<std::string>& result)
     // Write the frame with the detection boxes
     cv::Mat detectedFrame;
     frame.convertTo(detectedFrame, CV_8U);
-    cv::imwrite("camera.jpg", detectedFrame);
+    m_snapshot_writer.submit("camera.jpg", detectedFrame);
   }
 
   return;
 }
 
-// Remove the bounding boxes with low confidence using non-maxima suppression
-void DnnObjectDetection::postprocess(cv::Mat& frame, const std::vector<cv::Mat>& outs,
-                                     std::vector<std::string>& result)
+void DnnObjectDetection::detect(const std::vector<cv::Mat>& frames,
+                                std::vector<std::vector<Detection>>& results)
 {
-  std::vector<int> classIds;
-  std::vector<float> confidences;
-  std::vector<cv::Rect> boxes;
+  results.resize(frames.size());
+  if(frames.size() <= 1) {
+    if(!frames.empty()) detect(frames[0], results[0]);
+    return;
+  }
 
-  for(size_t i = 0; i < outs.size(); ++i) {
-    // Scan through all the bounding boxes output from the network and keep only the
-    // ones with high confidence scores. Assign the box's class label as the class
-    // with the highest score for the box.
-    float* data = (float*) outs[i].data;
-    for(int j = 0; j < outs[i].rows; ++j, data += outs[i].cols) {
-      cv::Mat scores = outs[i].row(j).colRange(5, outs[i].cols);
-      cv::Point classIdPoint;
-      double confidence;
-      // Get the value and location of the maximum score
-      minMaxLoc(scores, 0, &confidence, 0, &classIdPoint);
-      if(confidence > m_conf_threshold) {
-        int centerX = (int) (data[0] * frame.cols);
-        int centerY = (int) (data[1] * frame.rows);
-        int width = (int) (data[2] * frame.cols);
-        int height = (int) (data[3] * frame.rows);
-        int left = centerX - width / 2;
-        int top = centerY - height / 2;
-
-        classIds.push_back(classIdPoint.x);
-        confidences.push_back((float) confidence);
-        boxes.push_back(cv::Rect(left, top, width, height));
-      }
+  waitReady();
+  // One NCHW blob for the whole batch, so the network runs once per batch.
+  cv::Mat blob;
+  cv::dnn::blobFromImages(frames, blob, 1 / 255.0, cv::Size(m_input_width, m_input_height),
+                          cv::Scalar(0, 0, 0), true, false);
+
+  std::vector<cv::Mat> outs;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_net.setInput(blob);
+    m_net.forward(outs, getOutputsNames());
+  }
+
+  // Each output layer stacks the rows of all images, either as a 2D
+  // [N * rows, cols] or as a 3D [N, rows, cols] matrix depending on the
+  // OpenCV version. Slice out the rows of every image.
+  const int num_frames = static_cast<int>(frames.size());
+  for(auto& out : outs) {
+    if(out.dims == 3) {
+      out = out.reshape(1, out.size[0] * out.size[1]);
+    }
+  }
+  for(int n = 0; n < num_frames; ++n) {
+    std::vector<cv::Mat> frame_outs;
+    frame_outs.reserve(outs.size());
+    for(const auto& out : outs) {
+      const int rows = out.rows / num_frames;
+      frame_outs.push_back(out.rowRange(n * rows, (n + 1) * rows));
     }
+    postprocess(frames[n].size(), frame_outs, results[n]);
   }
+}
 
-  // Perform non maximum suppression to eliminate redundant overlapping boxes with
-  // lower confidences
+// Remove the bounding boxes with low confidence using non-maxima suppression
+void DnnObjectDetection::postprocess(const cv::Size& frame_size, const std::vector<cv::Mat>& outs,
+                                     std::vector<Detection>& result)
+{
+  YoloPostprocess::Candidates candidates;
+  for(size_t i = 0; i < outs.size(); ++i) {
+    YoloPostprocess::scan(outs[i], m_conf_threshold, frame_size, candidates);
+  }
+  const std::vector<int>& classIds = candidates.class_ids;
+  const std::vector<float>& confidences = candidates.confidences;
+  const std::vector<cv::Rect>& boxes = candidates.boxes;
+
+  // Perform non maximum suppression per class to eliminate redundant
+  // overlapping boxes with lower confidences
   std::vector<int> indices;
-  cv::dnn::NMSBoxes(boxes, confidences, m_conf_threshold, m_nms_threshold, indices);
+  YoloPostprocess::suppress(candidates, m_conf_threshold, m_nms_threshold, indices);
+
+  result.reserve(result.size() + indices.size());
   for(size_t i = 0; i < indices.size(); ++i) {
     int idx = indices[i];
-    cv::Rect box = boxes[idx];
-    result.push_back(m_classes[classIds[idx]]);
-    drawPred(classIds[idx], confidences[idx], box.x, box.y, box.x + box.width, box.y + box.height,
-             frame);
+    result.push_back(Detection{classIds[idx], confidences[idx], boxes[idx]});
+  }
+}
+
+// Draw the detections into frame; only done when annotation is enabled
+void DnnObjectDetection::annotate(cv::Mat& frame, const std::vector<Detection>& detections)
+{
+  for(const Detection& detection : detections) {
+    const cv::Rect& box = detection.box;
+    drawPred(detection.class_id, detection.confidence, box.x, box.y, box.x + box.width,
+             box.y + box.height, frame);
   }
 }
 
@@ -230,9 +421,6 @@ void DnnObjectDetection::drawPred(int classId, float conf, int left, int top, in
     label = m_classes[classId] + ":" + label;
   }
 
-  std::cout << m_classes[classId] << "," << top << "," << left << "," << right << "," << bottom
-            << std::endl;
-
   // Display the label at the top of the bounding box
   int baseLine;
   cv::Size labelSize = getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
@@ -244,6 +432,27 @@ void DnnObjectDetection::drawPred(int classId, float conf, int left, int top, in
           1);
 }
 
+// Runs the network on a blank frame and returns the time of one forward pass.
+// The first pass also allocates the layers, so the second one is measured.
+double DnnObjectDetection::measureLatency()
+{
+  const cv::Mat frame(m_input_height, m_input_width, CV_8UC3, cv::Scalar(0, 0, 0));
+  cv::Mat blob;
+  cv::dnn::blobFromImage(frame, blob, 1 / 255.0, cv::Size(m_input_width, m_input_height),
+                         cv::Scalar(0, 0, 0), true, false);
+
+  std::vector<cv::Mat> outs;
+  double latency_ms = 0.0;
+  for(int i = 0; i < 2; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    m_net.setInput(blob);
+    m_net.forward(outs, getOutputsNames());
+    latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                     .count();
+  }
+  return latency_ms;
+}
+
 // Get the names of the output layers
 std::vector<cv::String> DnnObjectDetection::getOutputsNames()
 {
@@ -27,8 +27,13 @@
 #ifndef OBJECTDETECTION_HPP_INC
 #define OBJECTDETECTION_HPP_INC
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <exception>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -37,8 +42,86 @@
 #include <opencv2/dnn.hpp>
 #include <opencv2/videoio.hpp>
 
+#include "snapshot-writer.hpp"
+
 using detector_ptr = std::shared_ptr<class ObjectDetection>;
 
+// Model and inference settings of DnnObjectDetection. model and config are
+// passed to cv::dnn::readNet(), which picks the framework (Darknet, ONNX,
+// ...) from the file extensions. The outputs are postprocessed as YOLO
+// region layers, so the model has to be a YOLO variant.
+struct DetectorConfig {
+  std::string model = "./config/yolov3.weights";
+  std::string config = "./config/yolov3.cfg";
+  std::string classes = "./config/coco.names";
+  std::string backend = "opencv";  // opencv | inference-engine
+  std::string precision = "fp32";  // fp32 | fp16
+  int input_width = 416;
+  int input_height = 416;
+  bool annotate = false;  // draw the detections into the snapshots
+  std::string snapshot_dir = ".";
+  double snapshot_rate = 1.0;  // snapshots per second; 0 disables them
+};
+
+// One detected object. class_id indexes ObjectDetection::classNames().
+struct Detection {
+  int class_id;
+  float confidence;
+  cv::Rect box;
+};
+
+// Recognizes frames that look the same as the last detected frame of the
+// same scene, e.g. camera, so that its detections can be reused instead of
+// running the network again. Frames are never compared across scenes, as
+// two cameras may well see alike views with different objects in them.
+//
+// A frame is reduced to a 32x32 grey thumbnail, and it is unchanged when no
+// thumbnail cell differs from the remembered one by more than threshold grey
+// levels. Comparing cells rather than a global hash keeps a person entering
+// a small part of the view from going unnoticed. Only detected frames are
+// remembered, so slow drift is caught once it adds up to the threshold. A
+// threshold of 0 disables the gate.
+class SceneChangeGate {
+ public:
+  struct Signature {
+    cv::Size frame_size;
+    cv::Mat thumbnail;
+  };
+
+  // capacity is the number of scenes remembered.
+  SceneChangeGate(int threshold, size_t capacity);
+
+  bool isEnabled() const { return m_threshold > 0; }
+  // Computes the signature of frame. Returns true and appends the
+  // detections of the remembered frame of scene to result if frame is
+  // unchanged.
+  bool lookup(const std::string& scene, const cv::Mat& frame, Signature& signature,
+              std::vector<Detection>& result);
+  // Remembers the detections of the frame of scene with signature,
+  // forgetting the least recently seen scene beyond capacity.
+  void update(const std::string& scene, Signature&& signature,
+              const std::vector<Detection>& detections);
+
+  uint64_t hits() const { return m_hits; }
+  uint64_t misses() const { return m_misses; }
+
+ private:
+  struct Entry {
+    std::string scene;
+    Signature signature;
+    std::vector<Detection> detections;
+  };
+
+  const int m_threshold;
+  const size_t m_capacity;
+
+  std::mutex m_mutex;
+  std::deque<Entry> m_entries;  // most recently seen scene first
+
+  std::atomic<uint64_t> m_hits;
+  std::atomic<uint64_t> m_misses;
+};
+
 class ObjectDetection {
  public:
   ObjectDetection() = default;
@@ -52,42 +135,66 @@ class ObjectDetection {
   ObjectDetection(const ObjectDetection&) = delete;
   ObjectDetection& operator=(const ObjectDetection&) = delete;
 
-  virtual void detect(cv::Mat frame, std::vector<std::string>& result) = 0;
+  // False while the model is still being loaded and warmed up.
+  virtual bool isReady() const { return true; }
+  // Blocks until the model is loaded. Throws std::runtime_error if it
+  // failed to load.
+  virtual void waitReady() {}
+  virtual const std::vector<std::string>& classNames() const = 0;
+  // True if an object named class_name is among detections.
+  bool contains(const std::vector<Detection>& detections, const std::string& class_name) const;
+  virtual void detect(cv::Mat frame, std::vector<Detection>& result) = 0;
+  // Detects objects in every frame; results[i] belongs to frames[i].
+  virtual void detect(const std::vector<cv::Mat>& frames,
+                      std::vector<std::vector<Detection>>& results);
 };
 
 class EmulateObjectDetection : public ObjectDetection {
  public:
   EmulateObjectDetection();
   ~EmulateObjectDetection() {}
-  void detect(cv::Mat frame, std::vector<std::string>& result) override;
+  const std::vector<std::string>& classNames() const override { return m_classes; }
+  using ObjectDetection::detect;
+  void detect(cv::Mat frame, std::vector<Detection>& result) override;
 
  private:
   std::vector<std::string> m_classes;
+  std::vector<int> m_candidates;  // every class but person
 };
 
 class DnnObjectDetection : public ObjectDetection {
  public:
-  DnnObjectDetection(const std::string& dummy_file);
+  DnnObjectDetection(const DetectorConfig& config, const std::string& dummy_file);
   ~DnnObjectDetection();
   DnnObjectDetection(DnnObjectDetection&&) = default;
   DnnObjectDetection& operator=(DnnObjectDetection&&) = default;
   DnnObjectDetection(const DnnObjectDetection&) = delete;
   DnnObjectDetection& operator=(const DnnObjectDetection&) = delete;
 
-  void detect(cv::Mat frame, std::vector<std::string>& result) override;
+  bool isReady() const override { return m_ready.load(std::memory_order_acquire); }
+  void waitReady() override;
+  const std::vector<std::string>& classNames() const override { return m_classes; }
+  void detect(cv::Mat frame, std::vector<Detection>& result) override;
+  void detect(const std::vector<cv::Mat>& frames,
+              std::vector<std::vector<Detection>>& results) override;
 
  private:
-  void postprocess(cv::Mat& frame, const std::vector<cv::Mat>& out, std::vector<std::string>& result);
+  void postprocess(const cv::Size& frame_size, const std::vector<cv::Mat>& out,
+                   std::vector<Detection>& result);
+  void annotate(cv::Mat& frame, const std::vector<Detection>& detections);
   void drawPred(int classId, float conf, int left, int top, int right, int bottom, cv::Mat& frame);
   std::vector<cv::String> getOutputsNames();
+  double measureLatency();
+  void load();
   void capture();
 
  private:
   const float m_conf_threshold = 0.5;   // Confidence threshold
   const float m_nms_threshold  = 0.4;   // Non-maximum suppression threshold
-  const int   m_input_width    = 416;   // Width of network's input image
-  const int   m_input_height   = 416;   // Height of network's input image
+  const int   m_input_width;           // Width of network's input image
+  const int   m_input_height;          // Height of network's input image
 
+  const DetectorConfig m_config;
   const std::string m_dummy_file;
 
   const bool m_is_dummy_mode;
@@ -95,12 +202,21 @@ class DnnObjectDetection : public ObjectDetection {
 
   cv::VideoCapture         m_camera;
   cv::Mat                  m_frame;
+  SnapshotWriter           m_snapshot_writer;
   cv::dnn::Net             m_net;
   std::vector<std::string> m_classes;
   std::thread              m_thread;
   mutable std::mutex       m_mutex;
 
   bool m_run;
+
+  // The network is loaded and warmed up on m_loader; detect() waits for it.
+  // m_load_error is set instead if it fails, for waitReady() to throw.
+  std::thread m_loader;
+  std::atomic<bool> m_ready;
+  std::mutex m_ready_mutex;
+  std::condition_variable m_ready_cond;
+  std::string m_load_error;
 };
 
 class CameraOpenException : public std::exception {
@@ -0,0 +1,300 @@
+/**
+ * @brief
+ * @author Yuki Koizumi
+ */
+#include "parameter.hpp"
+#include "frame-codec.hpp"
+#include "query-descriptor.hpp"
+#include "z-order.hpp"
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+Parameter &Parameter::instance() {
+  static Parameter object;
+  return object;
+}
+
+Parameter::Parameter()
+    : m_mode(0),
+      m_num_threads(std::max(1u, std::thread::hardware_concurrency())),
+      m_is_adaptive_fetch(true),
+      m_init_cwnd(1.0),
+      m_interest_lifetime(1000),
+      m_max_timeout(4000),
+      m_codec(FrameCodec::RAW),
+      m_quality(90),
+      m_is_letterbox_mode(false),
+      m_batch_size(8),
+      m_batch_window(10),
+      m_model("./config/yolov3.weights"),
+      m_model_config("./config/yolov3.cfg"),
+      m_classes_file("./config/coco.names"),
+      m_input_size(416),
+      m_backend("opencv"),
+      m_precision("fp32"),
+      m_is_annotate_mode(false),
+      m_snapshot_dir("."),
+      m_snapshot_rate(1.0),
+      m_change_threshold(0),
+      m_region(0),
+      m_max_fanout(256)
+{}
+
+void Parameter::parse(int argc, char **argv) {
+  boost::program_options::options_description cmdline_opt("Command line options");
+
+  try {
+    cmdline_opt.add_options()
+        ("help,h", "Show this help message")
+        ("cloud,c", "Run in cloud mode (fetch raw frames and detect objects on this node)")
+        ("edge,e", "Run in edge mode (workers detect objects)")
+        ("threads,t", boost::program_options::value<size_t>(),
+         "Number of worker threads for parsing, signing and inference (0: face thread only)")
+        ("window", boost::program_options::value<std::string>(),
+         "Congestion window of segment fetching in cloud mode: aimd (default) or fixed")
+        ("init-cwnd", boost::program_options::value<double>(),
+         "Initial congestion window in segments (the whole window in fixed mode)")
+        ("interest-lifetime", boost::program_options::value<uint64_t>(),
+         "Lifetime of segment Interests in milliseconds")
+        ("max-timeout", boost::program_options::value<uint64_t>(),
+         "Upper bound of the RTT-based retransmission timeout in milliseconds")
+        ("codec", boost::program_options::value<std::string>(),
+         "Codec of frames transferred in cloud mode: raw (default), jpeg, png or webp")
+        ("quality", boost::program_options::value<unsigned int>(),
+         "Quality of jpeg/webp frames (0-100); the compression level of png is quality / 10")
+        ("letterbox", "Have workers scale cloud mode frames down to the network input size")
+        ("batch-size", boost::program_options::value<size_t>(),
+         "Maximum number of cloud mode frames detected in one batch (1 disables batching)")
+        ("batch-window", boost::program_options::value<uint64_t>(),
+         "Time in milliseconds a batch waits for more frames after its first one")
+        ("model", boost::program_options::value<std::string>(),
+         "Detection model: yolov3, yolov3-tiny or the path of a Darknet/ONNX model file")
+        ("model-config", boost::program_options::value<std::string>(),
+         "Path of the model configuration file (e.g. Darknet .cfg)")
+        ("classes", boost::program_options::value<std::string>(),
+         "Path of the file listing the class names of the model")
+        ("input-size", boost::program_options::value<int>(),
+         "Width and height of the network input; a multiple of 32")
+        ("backend", boost::program_options::value<std::string>(),
+         "DNN backend: opencv or inference-engine")
+        ("precision", boost::program_options::value<std::string>(),
+         "DNN precision: fp32 or fp16")
+        ("annotate", "Draw detections into the camera.jpg snapshots (for debugging)")
+        ("snapshot-dir", boost::program_options::value<std::string>(),
+         "Directory the camera.jpg debugging snapshots are written to")
+        ("snapshot-rate", boost::program_options::value<double>(),
+         "Maximum number of snapshots written per second; 0 disables them")
+        ("change-threshold", boost::program_options::value<int>(),
+         "Grey level difference below which a frame of a camera counts as unchanged and "
+         "the previous detections of that camera are reused in cloud mode; 0 (default) "
+         "disables the check")
+        ("region", boost::program_options::value<std::string>(),
+         "Z-order prefix (e.g. 303) whose range and box queries this edge aggregates in edge mode")
+        ("cells", boost::program_options::value<std::string>(),
+         "Comma-separated locations of the workers below the region")
+        ("max-fanout", boost::program_options::value<size_t>(),
+         "Maximum number of workers and aggregators a query is forwarded to; larger "
+         "range and box queries are Nacked");
+
+    boost::program_options::options_description opt("Options");
+    opt.add(cmdline_opt);
+
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, opt), parameters);
+    boost::program_options::notify(parameters);
+
+    if(parameters.count("help")) {
+      std::cerr << cmdline_opt << std::endl;
+      exit(0);
+    }
+
+    if(parameters.count("cloud") == parameters.count("edge")) {
+      std::cerr << "Usage: " << argv[0] << " option[-c | -e]" << std::endl;
+      std::cerr << cmdline_opt << std::endl;
+      exit(2);
+    }
+    m_mode = parameters.count("cloud") ? 'c' : 'e';
+
+    if(parameters.count("threads")) {
+      m_num_threads = parameters["threads"].as<size_t>();
+    }
+    if(parameters.count("window")) {
+      const std::string window(parameters["window"].as<std::string>());
+      if(window == "aimd") {
+        m_is_adaptive_fetch = true;
+      } else if(window == "fixed") {
+        m_is_adaptive_fetch = false;
+      } else {
+        throw std::invalid_argument("unknown window mode: " + window);
+      }
+    }
+    if(parameters.count("init-cwnd")) {
+      m_init_cwnd = parameters["init-cwnd"].as<double>();
+      if(m_init_cwnd < 1.0) {
+        throw std::invalid_argument("init-cwnd must be at least 1");
+      }
+    }
+    if(parameters.count("interest-lifetime")) {
+      m_interest_lifetime = parameters["interest-lifetime"].as<uint64_t>();
+    }
+    if(parameters.count("max-timeout")) {
+      m_max_timeout = parameters["max-timeout"].as<uint64_t>();
+    }
+    if(parameters.count("codec")) {
+      const std::string codec(parameters["codec"].as<std::string>());
+      if(!FrameCodec::from_string(codec, m_codec)) {
+        throw std::invalid_argument("unknown codec: " + codec);
+      }
+    }
+    if(parameters.count("quality")) {
+      const unsigned int quality = parameters["quality"].as<unsigned int>();
+      if(quality > 100) {
+        throw std::invalid_argument("quality must be between 0 and 100");
+      }
+      m_quality = static_cast<uint8_t>(quality);
+    }
+    if(parameters.count("letterbox")) {
+      m_is_letterbox_mode = true;
+    }
+    if(parameters.count("batch-size")) {
+      m_batch_size = parameters["batch-size"].as<size_t>();
+      if(m_batch_size < 1) {
+        throw std::invalid_argument("batch-size must be at least 1");
+      }
+    }
+    if(parameters.count("batch-window")) {
+      m_batch_window = parameters["batch-window"].as<uint64_t>();
+    }
+    if(parameters.count("model")) {
+      m_model = parameters["model"].as<std::string>();
+      // Models shipped in ./config can be given by name.
+      if(m_model == "yolov3" || m_model == "yolov3-tiny") {
+        m_model_config = "./config/" + m_model + ".cfg";
+        m_model = "./config/" + m_model + ".weights";
+      } else {
+        m_model_config.clear();
+      }
+    }
+    if(parameters.count("model-config")) {
+      m_model_config = parameters["model-config"].as<std::string>();
+    }
+    if(parameters.count("classes")) {
+      m_classes_file = parameters["classes"].as<std::string>();
+    }
+    if(parameters.count("input-size")) {
+      m_input_size = parameters["input-size"].as<int>();
+      if(m_input_size < 32 || m_input_size % 32 != 0) {
+        throw std::invalid_argument("input-size must be a positive multiple of 32");
+      }
+    }
+    if(parameters.count("backend")) {
+      m_backend = parameters["backend"].as<std::string>();
+      if(m_backend != "opencv" && m_backend != "inference-engine") {
+        throw std::invalid_argument("backend must be opencv or inference-engine");
+      }
+    }
+    if(parameters.count("precision")) {
+      m_precision = parameters["precision"].as<std::string>();
+      if(m_precision != "fp32" && m_precision != "fp16") {
+        throw std::invalid_argument("precision must be fp32 or fp16");
+      }
+    }
+    if(parameters.count("annotate")) {
+      m_is_annotate_mode = true;
+    }
+    if(parameters.count("snapshot-dir")) {
+      m_snapshot_dir = parameters["snapshot-dir"].as<std::string>();
+    }
+    if(parameters.count("snapshot-rate")) {
+      m_snapshot_rate = parameters["snapshot-rate"].as<double>();
+      if(m_snapshot_rate < 0.0) {
+        throw std::invalid_argument("snapshot-rate must not be negative");
+      }
+    }
+    if(parameters.count("change-threshold")) {
+      m_change_threshold = parameters["change-threshold"].as<int>();
+      if(m_change_threshold < 0 || m_change_threshold > 255) {
+        throw std::invalid_argument("change-threshold must be between 0 and 255");
+      }
+    }
+    if(parameters.count("region")) {
+      const std::string region(parameters["region"].as<std::string>());
+      if(m_mode != 'e' || !QueryDescriptor::location_code(region, m_region)) {
+        throw std::invalid_argument("region must be a location in edge mode: " + region);
+      }
+      if(!parameters.count("cells")) {
+        throw std::invalid_argument("region needs the cells below it");
+      }
+      std::istringstream cells(parameters["cells"].as<std::string>());
+      std::string cell;
+      while(std::getline(cells, cell, ',')) {
+        uint64_t code;
+        if(!QueryDescriptor::location_code(cell, code) || !ZOrder::covers(m_region, code)) {
+          throw std::invalid_argument("cell is not a location below the region: " + cell);
+        }
+        m_cells.push_back(code);
+      }
+    }
+    if(parameters.count("max-fanout")) {
+      m_max_fanout = parameters["max-fanout"].as<size_t>();
+      if(m_max_fanout < 1) {
+        throw std::invalid_argument("max-fanout must be at least 1");
+      }
+    }
+
+  } catch(std::exception &e) {
+    std::cerr << "error: " << e.what() << std::endl;
+    exit(1);
+  } catch(...) {
+    std::cerr << "Catch unknown exception" << std::endl;
+    exit(1);
+  }
+
+  return;
+}
+
+void Parameter::print(std::ostream &os) const {
+  boost::format console_format("%1%:%|38t|%2%");
+  os << "Parameters" << std::endl;
+  os << console_format % "Mode" % (m_mode == 'c' ? "Cloud" : "Edge") << std::endl;
+  os << console_format % "Worker threads" % m_num_threads << std::endl;
+  os << console_format % "Fetch window" % (m_is_adaptive_fetch ? "AIMD" : "Fixed") << std::endl;
+  os << console_format % "Initial window" % m_init_cwnd << std::endl;
+  os << console_format % "Interest lifetime [ms]" % m_interest_lifetime << std::endl;
+  os << console_format % "Max timeout [ms]" % m_max_timeout << std::endl;
+  os << console_format % "Frame codec" % FrameCodec::to_string(m_codec) << std::endl;
+  os << console_format % "Frame quality" % static_cast<unsigned int>(m_quality) << std::endl;
+  os << console_format % "Letterboxed frames" % (m_is_letterbox_mode ? "On" : "Off") << std::endl;
+  os << console_format % "Inference batch size" % m_batch_size << std::endl;
+  os << console_format % "Inference batch window [ms]" % m_batch_window << std::endl;
+  os << console_format % "Model" % m_model << std::endl;
+  os << console_format % "Model configuration" % m_model_config << std::endl;
+  os << console_format % "Model classes" % m_classes_file << std::endl;
+  os << console_format % "Model input size" % m_input_size << std::endl;
+  os << console_format % "DNN backend" % m_backend << std::endl;
+  os << console_format % "DNN precision" % m_precision << std::endl;
+  os << console_format % "Annotation" % (m_is_annotate_mode ? "On" : "Off") << std::endl;
+  os << console_format % "Snapshot directory" % m_snapshot_dir << std::endl;
+  os << console_format % "Snapshot rate [1/s]" % m_snapshot_rate << std::endl;
+  os << console_format % "Scene change threshold" % m_change_threshold << std::endl;
+  if(m_region != 0) {
+    os << console_format % "Aggregated region" % QueryDescriptor::location_name(m_region)
+       << std::endl;
+    os << console_format % "Cells of the region" % m_cells.size() << std::endl;
+  }
+  os << console_format % "Maximum fan-out" % m_max_fanout << std::endl;
+  os << std::endl;
+
+  return;
+}
+
+std::ostream &operator<<(std::ostream &os, const Parameter &obj) {
+  obj.print(os);
+  return os;
+}
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yuki Koizumi
+ */
+#ifndef PARAMETER_HPP_INC
+#define PARAMETER_HPP_INC
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Parameter
+{
+ public:
+  ~Parameter() = default;
+  Parameter(const Parameter &) = delete;
+  Parameter &operator=(const Parameter) = delete;
+
+  static Parameter &instance();
+  void parse(int argc, char **argv);
+  void print(std::ostream &os) const;
+
+  int mode() const { return m_mode; }
+  size_t num_threads() const { return m_num_threads; }
+
+  // Segment fetching of raw frames in cloud mode
+  bool is_adaptive_fetch() const { return m_is_adaptive_fetch; }
+  double init_cwnd() const { return m_init_cwnd; }
+  uint64_t interest_lifetime() const { return m_interest_lifetime; }
+  uint64_t max_timeout() const { return m_max_timeout; }
+
+  // Codec of raw frames in cloud mode (FrameCodec::Type) and its quality
+  uint8_t codec() const { return m_codec; }
+  uint8_t quality() const { return m_quality; }
+  // Whether workers letterbox frames to the network input size
+  bool is_letterbox_mode() const { return m_is_letterbox_mode; }
+
+  // Batching of cloud mode frames for inference
+  size_t batch_size() const { return m_batch_size; }
+  uint64_t batch_window() const { return m_batch_window; }
+
+  // Object detection model and how it is run
+  const std::string &model() const { return m_model; }
+  const std::string &model_config() const { return m_model_config; }
+  const std::string &classes_file() const { return m_classes_file; }
+  int input_size() const { return m_input_size; }
+  const std::string &backend() const { return m_backend; }
+  const std::string &precision() const { return m_precision; }
+  bool is_annotate_mode() const { return m_is_annotate_mode; }
+  const std::string &snapshot_dir() const { return m_snapshot_dir; }
+  double snapshot_rate() const { return m_snapshot_rate; }
+  int change_threshold() const { return m_change_threshold; }
+
+  // Z-order prefix this edge aggregates in edge mode (0 for none) and the
+  // cells below it it forwards region queries to
+  uint64_t region() const { return m_region; }
+  const std::vector<uint64_t> &cells() const { return m_cells; }
+  // Maximum number of workers and aggregators a single query is forwarded to
+  size_t max_fanout() const { return m_max_fanout; }
+
+ private:
+  Parameter();
+
+ private:
+  int    m_mode;
+  size_t m_num_threads;
+
+  bool     m_is_adaptive_fetch;
+  double   m_init_cwnd;
+  uint64_t m_interest_lifetime;  // milliseconds
+  uint64_t m_max_timeout;        // milliseconds
+
+  uint8_t  m_codec;
+  uint8_t  m_quality;
+  bool     m_is_letterbox_mode;
+
+  size_t   m_batch_size;
+  uint64_t m_batch_window;       // milliseconds
+
+  std::string m_model;
+  std::string m_model_config;
+  std::string m_classes_file;
+  int         m_input_size;
+  std::string m_backend;
+  std::string m_precision;
+  bool        m_is_annotate_mode;
+  std::string m_snapshot_dir;
+  double      m_snapshot_rate;
+  int         m_change_threshold;
+
+  uint64_t              m_region;
+  std::vector<uint64_t> m_cells;
+  size_t                m_max_fanout;
+};
+
+std::ostream &operator<<(std::ostream &os, const Parameter &obj);
+
+#endif
@@ -36,10 +36,6 @@
 #include <sstream>
 #include <thread>
 
-#include <boost/algorithm/string/classification.hpp>
-#include <boost/algorithm/string/join.hpp>
-#include <boost/algorithm/string/replace.hpp>
-#include <boost/algorithm/string/split.hpp>
 #include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 
@@ -58,45 +54,52 @@
 #include <opencv2/opencv.hpp>
 
 #include "execute.hpp"
+#include "query-descriptor.hpp"
+#include "query-name.hpp"
+#include "region-resolver.hpp"
 
 using namespace ndn::literals::time_literals;
 
-Producer::Producer(int mode, detector_ptr detector)
-    : m_num_thread(0),
-      m_num_queue(0),
-      m_current_queue(0),
-      m_io_service_pool(m_num_queue),
-      m_worker_pool(),
-      m_thread_pool(),
-      m_timer_service(),
-      m_id_generator(1),
+namespace {
+// Time kept for sending the answer to a query before its deadline, so that
+// it reaches the edge or consumer that asked before the Interest expires.
+const uint64_t answer_margin_ms = 100;
+
+uint64_t unixTimeMillis()
+{
+  return ndn::time::toUnixTimestamp(ndn::time::system_clock::now()).count();
+}
+}  // namespace
+
+Producer::Producer(int mode, size_t num_threads,
+                   const ndn::util::SegmentFetcher::Options& fetch_options,
+                   const FrameRequest& frame_request, std::vector<std::string> class_names,
+                   RegionScope scope, batcher_ptr batcher)
+    : m_id_generator(1),
       m_edge_mode(mode),
-      m_detector(detector),
-      m_number_of_arrival_interest(0),
-      m_issued_interest(0)
+      m_fetch_options(fetch_options),
+      m_frame_request(frame_request),
+      m_class_names(std::move(class_names)),
+      m_class_list(QueryDescriptor::class_list_hash(m_class_names)),
+      m_scope(std::move(scope)),
+      m_region_prefix(m_scope.region != 0
+                          ? QueryName::prefix(QueryDescriptor::location_name(m_scope.region))
+                          : ndn::Name()),
+      m_batcher(batcher),
+      m_pool(num_threads)
 {
-  for(auto&& ios : m_io_service_pool) {
-    m_worker_pool.emplace_back(ios);
-  }
-  for(unsigned int n = 0; n < m_num_thread; ++n) {
-    m_thread_pool.emplace_back([this, n] { this->m_io_service_pool.at(n % m_num_queue).run(); });
-  }
   std::cerr << "mode: " << m_edge_mode << std::endl;
-
-  m_timer_worker.reset(new boost::asio::io_service::work(m_timer_service));
+  std::cerr << "[INFO] " << m_pool.size() << " worker threads" << std::endl;
 }
 
 Producer::~Producer()
 {
-  m_worker_pool.clear();
-  for(auto& thread : m_thread_pool) {
-    if(thread.joinable()) thread.join();
-  }
+  std::cerr << "[INFO] Worker pool executed " << m_pool.executed() << " tasks ("
+            << m_pool.stolen() << " stolen)" << std::endl;
 }
 
 void Producer::run()
 {
-  std::thread timer_thread([this] { this->m_timer_service.run(); });
   if(m_edge_mode == 'c') {
     std::cerr << "[INFO] Cloud mode" << std::endl;
     std::thread ndn_thread([this] {
@@ -107,6 +110,15 @@ void Producer::run()
                                          std::bind(&Producer::onRegisterFailed, this, _1, _2));
       this->m_ndn_face.processEvents();
     });
+    // The model is loaded while the face is up already. If that fails, the
+    // face is shut down and the failure is thrown to the caller.
+    try {
+      m_batcher->waitReady();
+    } catch(...) {
+      post_face([this] { this->m_ndn_face.shutdown(); });
+      ndn_thread.join();
+      throw;
+    }
     ndn_thread.join();
   } else if(m_edge_mode == 'e') {
     std::cerr << "[INFO] Edge mode" << std::endl;
@@ -116,242 +128,378 @@ void Producer::run()
                                          std::bind(&Producer::onInterest, this, _1, _2),
                                          ndn::RegisterPrefixSuccessCallback(),
                                          std::bind(&Producer::onRegisterFailed, this, _1, _2));
+      if(m_scope.region != 0) {
+        // Range and box queries of other edges reach us under our region.
+        const std::string region = QueryDescriptor::location_name(m_scope.region);
+        std::cerr << "[INFO] Aggregating region " << region << " of " << m_scope.cells.size()
+                  << " cells" << std::endl;
+        this->m_ndn_face.setInterestFilter(m_region_prefix,
+                                           std::bind(&Producer::onInterest, this, _1, _2),
+                                           ndn::RegisterPrefixSuccessCallback(),
+                                           std::bind(&Producer::onRegisterFailed, this, _1, _2));
+      }
       this->m_ndn_face.processEvents();
     });
     ndn_thread.join();
   }
+  return;
+}
+
+void Producer::open_session(const ndn::Interest& interest, uint64_t session_id, size_t expected,
+                            uint64_t timeout_ms)
+{
+  // Create new name, based on Interest's name
+  ndn::Name data_name(interest.getName());
+  data_name
+      .append("IoT")     // add "teDEBUGstAdpp" component to Interest name
+      .appendVersion();  // add "version" component (current UNIX timestamp in milliseconds)
 
-  timer_thread.join();
+  // Create Data packet. It is signed in send_data() once its content is known.
+  std::shared_ptr<ndn::Data> data_packet(new ndn::Data());
+  data_packet->setName(data_name);
+  data_packet->setFreshnessPeriod(1_ms);  // 1 milli-seconds
+
+  // The timer runs on the face's event loop, so the session is always
+  // completed on the same thread that talks to the face.
+  std::shared_ptr<boost::asio::steady_timer> timer(
+      new boost::asio::steady_timer(m_ndn_face.getIoService()));
+  timer->expires_from_now(std::chrono::milliseconds(timeout_ms));
+  timer->async_wait(boost::bind(&Producer::send_data, this, boost::asio::placeholders::error, session_id));
+  SessionManager::instance().add(session_id, data_packet, timer, expected);
   return;
 }
 
 void Producer::onInterest(const ndn::InterestFilter& filter, const ndn::Interest& interest)
+{
+  uint64_t session_id(m_id_generator());
+  post_task([this, interest, session_id] { this->processInterest(interest, session_id); });
+}
+
+void Producer::processInterest(const ndn::Interest& interest, uint64_t session_id)
 {
   std::stringstream ss;
   ss << "Receive Interest packet: " << interest;
   std::cerr << ss.str().c_str() << std::endl;
   ss.clear();
   ss.str("");
-  m_number_of_arrival_interest = 0;
-  m_issued_interest = 0;
-
-  // Create new name, based on Interest's name
-  ndn::Name data_name(interest.getName());
-  data_name
-      .append("IoT")     // add "teDEBUGstAdpp" component to Interest name
-      .appendVersion();  // add "version" component (current UNIX timestamp in milliseconds)
 
   if(!interest.hasApplicationParameters()) {
     std::cerr << "[WARN] Received packet does not have a parameter field." << std::endl;
   }
 
-  uint64_t session_id(m_id_generator());
-
-  std::string interest_name(decodeURI(interest.getName().toUri()));
-  std::vector<std::string> reinvoked_name;
-  convertInterestName(interest_name, reinvoked_name);
-  m_issued_interest = reinvoked_name.size();
-
-  // Create Data packet
-  std::shared_ptr<ndn::Data> data_packet(new ndn::Data());
-  data_packet->setName(data_name);
-  data_packet->setFreshnessPeriod(1_ms);  // 1 milli-seconds
-  m_key_chain.sign(*data_packet);
-
-  std::shared_ptr<boost::asio::steady_timer> timer(new boost::asio::steady_timer(m_timer_service));
-  timer->expires_from_now(std::chrono::milliseconds(m_timeout_second));
-  timer->async_wait(boost::bind(&Producer::send_data, this, boost::asio::placeholders::error, session_id));
-  SessionManager::instance().add(session_id, data_packet, timer);
+  QueryDescriptor descriptor;
+  boost::string_view function;
+  const query_status status = readQuery(interest, session_id, descriptor, function);
+  if(status == query_status::too_large) {
+    sendNack(interest);
+    return;
+  } else if(status != query_status::ok) {
+    std::cerr << "[WARN] Interest does not hold a query" << std::endl;
+    descriptor.locations.clear();
+    descriptor.regions.clear();
+  }
 
-  for(unsigned int j = 0; j < reinvoked_name.size(); j++) {
-    std::cerr << "[INFO] Interest name URI: " << interest.getName().toUri().c_str() << std::endl;
-    std::cerr << "[INFO] Converted name: " << interest_name.c_str() << std::endl;
-    std::cerr << "[INFO] Re-invoke interest name: " << reinvoked_name[j].c_str() << std::endl;
+  // The answer has to be sent before the deadline, which aggregators get
+  // from the edge that asked them.
+  const uint64_t now = unixTimeMillis();
+  const uint64_t remaining =
+      (descriptor.deadline > now + answer_margin_ms) ? descriptor.deadline - now - answer_margin_ms
+                                                     : 0;
+  if(remaining == 0) {
+    std::cerr << "[WARN] Query is past its deadline" << std::endl;
+    descriptor.locations.clear();
+    descriptor.regions.clear();
+  }
+  open_session(interest, session_id, descriptor.locations.size() + descriptor.regions.size(),
+               std::min<uint64_t>(m_timeout_second, remaining));
+  if(descriptor.locations.empty() && descriptor.regions.empty()) {
+    on_answer(SessionManager::status::complete, session_id);
+    return;
+  }
 
-    ndn::Name interestName(reinvoked_name[j] + "/" + std::to_string(session_id));
-    ndn::Interest re_interest(interestName);
+  // Every worker gets the query with its own location only, and every
+  // aggregator with its own region only.
+  const std::vector<uint64_t> locations(std::move(descriptor.locations));
+  const std::vector<uint64_t> regions(std::move(descriptor.regions));
+  std::vector<ndn::Interest> re_interests;
+  for(const uint64_t location : locations) {
+    const std::string location_name = QueryDescriptor::location_name(location);
+    ndn::Interest re_interest(QueryName::forward(function, location_name, session_id));
+    std::cerr << "[INFO] Re-invoke interest name: " << re_interest.getName() << std::endl;
+    re_interest.setCanBePrefix(true);
+    re_interest.setMustBeFresh(true);
+    re_interest.setInterestLifetime(
+        ndn::time::milliseconds(std::max<uint64_t>(1, std::min<uint64_t>(1000, remaining))));
+    descriptor.locations.assign(1, location);
+    descriptor.regions.clear();
+    re_interest.setApplicationParameters(descriptor.encode());
+    re_interests.push_back(re_interest);
+  }
+  // Aggregators have to answer before our own session ends.
+  descriptor.deadline -= answer_margin_ms;
+  for(const uint64_t region : regions) {
+    const std::string region_name = QueryDescriptor::location_name(region);
+    ndn::Interest re_interest(QueryName::forward(function, region_name, session_id));
+    std::cerr << "[INFO] Re-invoke interest name: " << re_interest.getName() << std::endl;
     re_interest.setCanBePrefix(true);
     re_interest.setMustBeFresh(true);
-    re_interest.setInterestLifetime(1_s);
-    std::vector<uint8_t> parameter;
-    parameter.push_back(m_edge_mode);
-    re_interest.setApplicationParameters(parameter.data(), parameter.size());
+    re_interest.setInterestLifetime(ndn::time::milliseconds(remaining));
+    descriptor.locations.clear();
+    descriptor.regions.assign(1, region);
+    re_interest.setApplicationParameters(descriptor.encode());
+    re_interests.push_back(re_interest);
+  }
 
-    std::cerr << "Sending Interest " << re_interest << std::endl;
+  post_face([this, re_interests, session_id] {
+    for(const ndn::Interest& re_interest : re_interests) {
+      std::cerr << "Sending Interest " << re_interest << std::endl;
+      m_ndn_face.expressInterest(re_interest, std::bind(&Producer::onData, this, _1, _2, session_id),
+                                 std::bind(&Producer::onNack, this, _1, _2, session_id),
+                                 std::bind(&Producer::onTimeout, this, _1, session_id));
+    }
+  });
+}
 
-    m_ndn_face.expressInterest(re_interest, std::bind(&Producer::onData, this, _1, _2),
-                               std::bind([] { std::cerr << "Nack" << std::endl; }),
-                               std::bind([] { std::cerr << "Timeout" << std::endl; }));
+void Producer::onInterest_Cloud(const ndn::InterestFilter& filter, const ndn::Interest& interest)
+{
+  if(!m_batcher->isReady()) {
+    std::cerr << "[WARN] Detector is warming up, sending Nack" << std::endl;
+    ndn::lp::Nack nack(interest);
+    nack.setReason(ndn::lp::NackReason::CONGESTION);
+    m_ndn_face.put(nack);
+    return;
   }
+  uint64_t session_id(m_id_generator());
+  post_task([this, interest, session_id] { this->processInterest_Cloud(interest, session_id); });
 }
 
-void Producer::onInterest_Cloud(const ndn::InterestFilter& filter, const ndn::Interest& interest)
+void Producer::processInterest_Cloud(const ndn::Interest& interest, uint64_t session_id)
 {
   std::stringstream ss;
   ss << "Receive Interest packet: " << interest;
   std::cerr << ss.str().c_str() << std::endl;
   ss.clear();
   ss.str("");
-  m_number_of_arrival_interest = 0;
-  m_issued_interest = 0;
-
-  // Create new name, based on Interest's name
-  ndn::Name data_name(interest.getName());
-  data_name
-      .append("IoT")     // add "teDEBUGstAdpp" component to Interest name
-      .appendVersion();  // add "version" component (current UNIX timestamp in milliseconds)
 
   if(!interest.hasApplicationParameters()) {
     std::cerr << "[WARN] Received packet does not have a parameter field." << std::endl;
   }
 
-  uint64_t session_id(m_id_generator());
-
-  m_target_name = ExtractTargets(decodeURI(interest.getName().toUri()));
-  std::string interest_name(decodeURI(interest.getName().toUri()));
-  std::vector<std::string> reinvoked_name;
-  convertInterestName(interest_name, reinvoked_name);
-  m_issued_interest = reinvoked_name.size();
-
-  // Create Data packet
-  std::shared_ptr<ndn::Data> data_packet(new ndn::Data());
-  data_packet->setName(data_name);
-  data_packet->setFreshnessPeriod(1_ms);  // 10 seconds
-  m_key_chain.sign(*data_packet);
-
-  std::shared_ptr<boost::asio::steady_timer> timer(new boost::asio::steady_timer(m_timer_service));
-  timer->expires_from_now(std::chrono::milliseconds(m_timeout_second));
-  timer->async_wait(boost::bind(&Producer::send_data, this, boost::asio::placeholders::error, session_id));
-  SessionManager::instance().add(session_id, data_packet, timer);
+  QueryDescriptor descriptor;
+  boost::string_view function;
+  const query_status status = readQuery(interest, session_id, descriptor, function);
+  if(status == query_status::too_large) {
+    sendNack(interest);
+    return;
+  } else if(status != query_status::ok) {
+    std::cerr << "[WARN] Interest does not hold a query" << std::endl;
+    descriptor.locations.clear();
+  }
+  // Detection runs here, so the workers only need to know how to send frames.
+  const std::vector<std::string> target_name = descriptor.target_names(m_class_names);
+  descriptor.targets.clear();
 
-  for(unsigned int j = 0; j < reinvoked_name.size(); j++) {
-    std::cerr << "[INFO] Interest name URI: " << interest.getName().toUri().c_str() << std::endl;
-    std::cerr << "[INFO] Converted name: " << interest_name.c_str() << std::endl;
-    std::cerr << "[INFO] Re-invoke interest name: " << reinvoked_name[j].c_str() << std::endl;
+  open_session(interest, session_id, descriptor.locations.size(), m_timeout_second);
+  if(descriptor.locations.empty()) {
+    on_answer(SessionManager::status::complete, session_id);
+    return;
+  }
 
-    ndn::Name interestName(reinvoked_name[j] + "/" + std::to_string(session_id));
-    ndn::Interest re_interest(interestName);
+  const std::vector<uint64_t> locations(std::move(descriptor.locations));
+  std::vector<std::pair<ndn::Interest, std::shared_ptr<Executor>>> fetches;
+  for(const uint64_t location : locations) {
+    const std::string location_name = QueryDescriptor::location_name(location);
+    // Without parameters, so that the segment Interests derived from it are
+    // satisfied by segments named after it.
+    ndn::Name name(QueryName::forward(function, location_name, session_id));
+    name.append(FrameCodec::request_key(m_frame_request));
+    ndn::Interest re_interest(name);
+    std::cerr << "[INFO] Re-invoke interest name: " << re_interest.getName() << std::endl;
     re_interest.setCanBePrefix(true);
     re_interest.setMustBeFresh(true);
-    m_location_name = ExtractLocname(reinvoked_name[j] + "/" + std::to_string(session_id));
-
-    std::cerr << "Cloud: Sending Interest " << re_interest << std::endl;
 
-    ndn::util::SegmentFetcher::Options Opt;
-    Opt.interestLifetime = 1_s;
-    Opt.useConstantCwnd = true;
-    Opt.initCwnd = 1;
-
-    Executor executor(re_interest.getName().toUri().c_str(), m_location_name[0], m_target_name[0], std::to_string(session_id), m_detector, this);
-    std::thread ndn_thread([this, re_interest, Opt, executor] {
-      auto fetcher = ndn::util::SegmentFetcher::start(m_ndn_face, re_interest, ndn::security::v2::getAcceptAllValidator(), Opt);
-      fetcher->onComplete.connect(bind(&Executor::afterFetchComplete, executor, _1));
-      fetcher->onError.connect(bind(&Executor::afterFetchError, executor, _1, _2));
-    });
-    ndn_thread.join();
+    std::shared_ptr<Executor> executor(new Executor(re_interest.getName().toUri(), location_name,
+                                                    target_name, session_id, m_batcher, this));
+    fetches.emplace_back(re_interest, executor);
   }
+
+  // All fetches of the query are started back to back on the face's event
+  // loop and proceed concurrently; each completion is handed to the pool and
+  // feeds the session through adddata()/addfailure().
+  post_face([this, fetches] {
+    for(const auto& fetch : fetches) {
+      std::cerr << "Cloud: Sending Interest " << fetch.first << std::endl;
+      std::shared_ptr<Executor> executor(fetch.second);
+      executor->afterFetchStart();
+      // The fetcher keeps itself alive until it completes or fails.
+      auto fetcher = ndn::util::SegmentFetcher::start(
+          m_ndn_face, fetch.first, ndn::security::v2::getAcceptAllValidator(), m_fetch_options);
+      fetcher->afterSegmentReceived.connect(
+          [executor](const ndn::Data& data) { executor->afterSegmentReceived(data); });
+      fetcher->afterSegmentTimedOut.connect([executor] { executor->afterSegmentTimedOut(); });
+      fetcher->afterSegmentNacked.connect([executor] { executor->afterSegmentNacked(); });
+      fetcher->onComplete.connect([this, executor](ndn::ConstBufferPtr data) {
+        this->post_task([executor, data] { executor->afterFetchComplete(data); });
+      });
+      fetcher->onError.connect([executor](uint32_t errorCode, const std::string& errorMsg) {
+        executor->afterFetchError(errorCode, errorMsg);
+      });
+    }
+  });
 }
 
-void Producer::adddata(std::string result)
+query_status Producer::readQuery(const ndn::Interest& interest, uint64_t session_id,
+                                           QueryDescriptor& descriptor,
+                                           boost::string_view& function)
 {
-  const size_t length = result.length();
-  const uint8_t* value = reinterpret_cast<uint8_t*>(&result[0]);
-  std::cerr << result << std::endl;
-  std::string err;
-  json11::Json json_obj = json11::Json::parse(result, err);
-  if(err.empty() == false) {
-    std::cerr << "ERROR: " << err.c_str() << std::endl;
-  }
-  const json11::Json& obj = json_obj["session_id"];
-  if(obj.is_null()) {
-    std::cerr << "ERROR: this packet is discarded because it does not convey any session IDs."
-              << std::endl;
-    return;
+  if(interest.hasApplicationParameters() &&
+     descriptor.decode(interest.getApplicationParameters())) {
+    if(descriptor.class_list != 0 && descriptor.class_list != m_class_list) {
+      std::cerr << "[WARN] Targets index into another class list than ours" << std::endl;
+      return query_status::invalid;
+    }
+    // Other edges forward queries to our region with their session id.
+    const bool is_forwarded = m_scope.region != 0 && m_region_prefix.isPrefixOf(interest.getName());
+    function = QueryName::function_of(interest.getName(), is_forwarded);
+  } else {
+    // Consumers that put the query text in the name
+    Query query;
+    if(!QueryName::parse(interest.getName(), false, query)) {
+      return query_status::invalid;
+    }
+    function = query.function;
+    descriptor = QueryDescriptor();
+    for(const boost::string_view& location : query.locations) {
+      // "first-last" is a Z-order range and "corner:corner" a box.
+      const size_t separator = location.find_first_of("-:");
+      QueryDescriptor::Span span;
+      if(separator == boost::string_view::npos) {
+        if(QueryDescriptor::location_code(location, span.first)) {
+          descriptor.locations.push_back(span.first);
+          continue;
+        }
+      } else if(QueryDescriptor::location_code(location.substr(0, separator), span.first) &&
+                QueryDescriptor::location_code(location.substr(separator + 1), span.last)) {
+        (location[separator] == '-' ? descriptor.ranges : descriptor.boxes).push_back(span);
+        continue;
+      }
+      std::cerr << "[WARN] Invalid location " << location << std::endl;
+      return query_status::invalid;
+    }
+    if(!descriptor.set_targets(Query::to_strings(query.targets), m_class_names)) {
+      std::cerr << "[WARN] Some targets are not classes of the model" << std::endl;
+    }
+    descriptor.options = QueryDescriptor::REPORT_AGE;
   }
-  uint64_t session_id = boost::lexical_cast<uint64_t>(obj.string_value());
 
-  bool status = SessionManager::instance().append_payload(session_id, value, length);
-  if(status == false) {
-    std::cerr << "ERROR: this packet is discarded because the corresponding session does not exist."
-              << std::endl;
+  descriptor.edge_mode = m_edge_mode;
+  descriptor.class_list = m_class_list;
+  descriptor.session_id = session_id;
+  if(descriptor.deadline == 0) {
+    // Answers arriving after the consumer has given up are of no use.
+    descriptor.deadline =
+        ndn::time::toUnixTimestamp(ndn::time::system_clock::now() + interest.getInterestLifetime())
+            .count();
   }
-
-  m_number_of_arrival_interest++;
-  if(m_number_of_arrival_interest == m_issued_interest) {
-    std::cerr << "send data" << std::endl;
-    boost::system::error_code error;
-    send_data(error, session_id);
-    m_number_of_arrival_interest = 0;
-    m_issued_interest = 0;
+  if(function.empty() || descriptor.targets.empty()) {
+    return query_status::invalid;
   }
-
-  return;
+  return resolve_regions(descriptor, m_edge_mode, m_scope);
 }
 
-void Producer::onData(const ndn::Interest&, const ndn::Data& data)
+void Producer::sendNack(const ndn::Interest& interest)
 {
-  const ndn::Block wire = data.getContent();
-  const size_t length = wire.value_size();
-  const uint8_t* value = wire.value();
+  std::cerr << "[WARN] Query would be forwarded to more than " << m_scope.max_fanout
+            << " workers, sending Nack" << std::endl;
+  ndn::lp::Nack nack(interest);
+  nack.setReason(ndn::lp::NackReason::NONE);
+  post_face([this, nack] { m_ndn_face.put(nack); });
+}
 
-  std::string str;
-  std::copy(value, value + length, std::back_inserter(str));
+void Producer::adddata(uint64_t session_id, const std::string& result)
+{
+  std::cerr << result << std::endl;
+  SessionManager::status status = SessionManager::instance().append_payload(
+      session_id, reinterpret_cast<const uint8_t*>(result.data()), result.length());
+  on_answer(status, session_id);
+  return;
+}
 
-  std::string err;
-  json11::Json json_obj = json11::Json::parse(str, err);
-  if(err.empty() == false) {
-    std::cerr << "ERROR: " << err.c_str() << std::endl;
-  }
-  const json11::Json& obj = json_obj["session_id"];
-  if(obj.is_null()) {
-    std::cerr << "ERROR: this packet is discarded because it does not convey any session IDs."
-              << std::endl;
-    return;
-  }
-  uint64_t session_id = boost::lexical_cast<uint64_t>(obj.string_value());
+void Producer::addfailure(uint64_t session_id)
+{
+  on_answer(SessionManager::instance().append_failure(session_id), session_id);
+  return;
+}
 
-  bool status = SessionManager::instance().append_payload(session_id, value, length);
-  if(status == false) {
+void Producer::on_answer(SessionManager::status status, uint64_t session_id)
+{
+  if(status == SessionManager::status::not_found) {
     std::cerr << "ERROR: this packet is discarded because the corresponding session does not exist."
               << std::endl;
-  }
-
-  m_number_of_arrival_interest++;
-  // std::cerr << m_number_of_arrival_interest << " " << m_issued_interest << std::endl;
-  if(m_number_of_arrival_interest == m_issued_interest) {
+  } else if(status == SessionManager::status::complete) {
     std::cerr << "send data" << std::endl;
     boost::system::error_code error;
     send_data(error, session_id);
-    m_number_of_arrival_interest = 0;
-    m_issued_interest = 0;
   }
   return;
 }
 
-void Producer::onNack(const ndn::Interest&, ndn::lp::Nack& nack)
+void Producer::onData(const ndn::Interest&, const ndn::Data& data, uint64_t session_id)
+{
+  const ndn::Block& wire = data.getContent();
+  SessionManager::status status =
+      SessionManager::instance().append_payload(session_id, wire.value(), wire.value_size());
+  on_answer(status, session_id);
+  return;
+}
+
+void Producer::onNack(const ndn::Interest&, const ndn::lp::Nack& nack, uint64_t session_id)
 {
   std::cerr << "Received Nack with reason " << nack.getReason() << std::endl;
+  addfailure(session_id);
 }
 
-void Producer::onTimeout(const ndn::Interest& interest)
+void Producer::onTimeout(const ndn::Interest& interest, uint64_t session_id)
 {
   std::cerr << "Timeout for  " << interest << std::endl;
+  addfailure(session_id);
 }
 
 void Producer::send_data(const boost::system::error_code& error, uint64_t session_id)
 {
-  try {
-    const std::vector<uint8_t>& buffer = SessionManager::instance().buffer(session_id);
-    std::shared_ptr<ndn::Data> data_packet = SessionManager::instance().data_packet(session_id);
-    data_packet->setContent(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
-    this->m_ndn_face.put(*data_packet);
-    std::cerr << "[INFO] Sent a data packet " << data_packet->getName().toUri().c_str()
-              << std::endl;
-    SessionManager::instance().dump(std::cerr);
-    SessionManager::instance().erase(session_id);
-  } catch(std::out_of_range&) {
+  if(error == boost::asio::error::operation_aborted) {
+    // The session has already been completed and its timer was cancelled.
+    return;
+  }
+
+  SessionManager::session_ptr session = SessionManager::instance().release(session_id);
+  if(session == nullptr) {
     std::cerr << "ERROR: Session does not exist." << std::endl;
+    return;
   }
+
+  post_task([this, session, session_id] {
+    std::shared_ptr<ndn::Data> data_packet = session->data_ptr;
+    {
+      std::lock_guard<std::mutex> lock(session->mutex);
+      if(session->received < session->expected) {
+        std::cerr << "[WARN] Session " << session_id << " timed out with " << session->received
+                  << "/" << session->expected << " answers" << std::endl;
+      }
+      data_packet->setContent(reinterpret_cast<const uint8_t*>(session->buffer.data()),
+                              session->buffer.size());
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_key_chain_mutex);
+      m_key_chain.sign(*data_packet);
+    }
+    post_face([this, session, data_packet] {
+      session->timer_ptr->cancel();
+      this->m_ndn_face.put(*data_packet);
+      std::cerr << "[INFO] Sent a data packet " << data_packet->getName().toUri().c_str()
+                << std::endl;
+    });
+  });
   return;
 }
 
@@ -362,142 +510,16 @@ void Producer::onRegisterFailed(const ndn::Name& prefix, const std::string& reas
   m_ndn_face_ptr->shutdown();
 }
 
-void Producer::convertInterestName(const std::string& interest_name, std::vector<std::string> &interest_name_list)
-{
-  std::vector<std::string> token_list;
-  boost::algorithm::split(token_list, interest_name, boost::is_any_of("/"));
-
-  std::string keyword(token_list.back());
-  token_list.pop_back();
-
-  std::string function_name(token_list.back());
-  token_list.pop_back();
-  std::string routable_prefix(boost::algorithm::join(token_list, "/"));
-
-  std::cerr << "Parse results:" << std::endl
-            << "routable: " << routable_prefix << std::endl
-            << "function: " << function_name << std::endl
-            << "keywords: " << keyword << std::endl;
-
-  std::vector<std::string> key_list;
-  boost::algorithm::split(key_list, keyword, boost::is_any_of(" "));
-  std::string target(key_list.back());
-  key_list.pop_back();
-  std::string location_key(key_list.back());
-
-  std::vector<std::string> lockey_list;
-  boost::algorithm::split(lockey_list, location_key, boost::is_any_of(":"));
-  std::string location(lockey_list.back());
-  boost::algorithm::replace_all(location, "[", "");
-  boost::algorithm::replace_all(location, "]", "");
-
-  std::vector<std::string> location_list;
-  boost::algorithm::split(location_list, location, boost::is_any_of(","));
-
-  std::vector<std::string> location_name_list;
-  for(unsigned int i = 0; i < location_list.size(); i++) {
-    std::vector<std::string> tmp;
-
-    for(unsigned int j = 0; j < location_list[i].size(); j += 1) {
-      tmp.push_back(location_list[i].substr(j, 1));
-    }
-    std::string location_name("/" + boost::algorithm::join(tmp, "/"));
-
-    location_name_list.push_back(location_name);
-  };
-
-  for(unsigned int i = 0; i < location_name_list.size(); i++) {
-    std::string name(location_name_list[i] + "/" + function_name + "/" + "#a:[" + location_list[i] + "] " + target);
-    std::cerr << "Interest name: " << name << std::endl;
-    interest_name_list.push_back(name);
-  }
-  return;
-}
-
-std::vector<std::string> Producer::ExtractTargets(const std::string& interest_name)
-{
-  std::vector<std::string> token_list;
-  boost::algorithm::split(token_list, interest_name, boost::is_any_of("/"));
-
-  // token_list.pop_back();
-  std::string keyword(token_list.back());
-  std::vector<std::string> key_list;
-  boost::algorithm::split(key_list, keyword, boost::is_any_of(" "));
-
-  std::string material(key_list.back());
-  std::vector<std::string> material_list;
-  boost::algorithm::split(material_list, material, boost::is_any_of(":"));
-
-  std::string target(material_list.back());
-  boost::algorithm::replace_all(target, "[", "");
-  boost::algorithm::replace_all(target, "]", "");
-
-  std::vector<std::string> target_list;
-  boost::algorithm::split(target_list, target, boost::is_any_of(","));
-
-  return target_list;
-}
-
-std::vector<std::string> Producer::ExtractLocname(const std::string& interest_name)
-{  //冗長
-  std::cerr << interest_name << std::endl;
-  std::vector<std::string> token_list;
-  boost::algorithm::split(token_list, interest_name, boost::is_any_of("/"));
-
-  token_list.pop_back();
-  std::string keyword(token_list.back());
-  token_list.pop_back();
-
-  std::string function_name(token_list.back());
-  token_list.pop_back();
-  std::string routable_prefix(boost::algorithm::join(token_list, "/"));
-
-  std::vector<std::string> key_list;
-  boost::algorithm::split(key_list, keyword, boost::is_any_of(" "));
-  std::string target(key_list.back());
-  key_list.pop_back();
-  std::string location_key(key_list.back());
-
-  std::vector<std::string> lockey_list;
-  boost::algorithm::split(lockey_list, location_key, boost::is_any_of(":"));
-  std::string location(lockey_list.back());
-  boost::algorithm::replace_all(location, "[", "");
-  boost::algorithm::replace_all(location, "]", "");
-
-  std::vector<std::string> loc_list;
-  boost::algorithm::split(loc_list, location, boost::is_any_of(","));
-
-  return loc_list;
-}
-
-std::string Producer::decodeURI(const std::string& uri)
-{
-  std::string replaced_string(uri);
-
-  boost::algorithm::replace_all(replaced_string, "%23", "#");
-  boost::algorithm::replace_all(replaced_string, "%3A", ":");
-  boost::algorithm::replace_all(replaced_string, "%2C", ",");
-  boost::algorithm::replace_all(replaced_string, "%5B", "[");
-  boost::algorithm::replace_all(replaced_string, "%5D", "]");
-  boost::algorithm::replace_all(replaced_string, "%20", " ");
-  boost::algorithm::replace_all(replaced_string, "%27", "'");
-  boost::algorithm::replace_all(replaced_string, "%28", "(");
-  boost::algorithm::replace_all(replaced_string, "%29", ")");
-  boost::algorithm::replace_all(replaced_string, "%2A", "*");
-
-  return replaced_string;
-}
-
 template <class F>
 void Producer::post_task(F f)
 {
-  this->io_service().post(f);
+  m_pool.post(f);
   return;
 }
 
-boost::asio::io_service& Producer::io_service()
+template <class F>
+void Producer::post_face(F f)
 {
-  ++m_current_queue;
-  m_current_queue %= m_current_queue % m_num_queue;
-  return m_io_service_pool.at(m_current_queue);
+  m_ndn_face.getIoService().post(f);
+  return;
 }
@@ -29,6 +29,7 @@
 
 #include <memory>
 #include <random>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
@@ -36,12 +37,19 @@
 #include <boost/asio.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/system/error_code.hpp>
+#include <boost/utility/string_view.hpp>
 
 #include <ndn-cxx/face.hpp>
 #include <ndn-cxx/security/key-chain.hpp>
 #include <ndn-cxx/security/validator-null.hpp>
+#include <ndn-cxx/util/segment-fetcher.hpp>
 
-#include "objectdetection.hpp"
+#include "frame-codec.hpp"
+#include "inference-batcher.hpp"
+#include "query-descriptor.hpp"
+#include "region-resolver.hpp"
+#include "session-manager.hpp"
+#include "thread-pool.hpp"
 
 namespace ndn {
 class Interest;
@@ -52,28 +60,41 @@ class Name;
 
 class Producer : boost::noncopyable {
  public:
-  Producer(int mode, detector_ptr detector);
+  Producer(int mode, size_t num_threads, const ndn::util::SegmentFetcher::Options& fetch_options,
+           const FrameRequest& frame_request, std::vector<std::string> class_names,
+           RegionScope scope, batcher_ptr batcher);
   ~Producer();
   void run();
-  void adddata(std::string result);
+  void adddata(uint64_t session_id, const std::string& result);
+  void addfailure(uint64_t session_id);
 
  private:
   void onInterest(const ndn::InterestFilter& filter, const ndn::Interest& interest);
   void onInterest_Cloud(const ndn::InterestFilter& filter, const ndn::Interest& interest);
+  void processInterest(const ndn::Interest& interest, uint64_t session_id);
+  void processInterest_Cloud(const ndn::Interest& interest, uint64_t session_id);
   void onRegisterFailed(const ndn::Name& prefix, const std::string& reason);
-  void onData(const ndn::Interest&, const ndn::Data& data);
-  void onNack(const ndn::Interest&, ndn::lp::Nack& nack);
-  void onTimeout(const ndn::Interest& interest);
-
+  // Reads the query of interest from its QueryDescriptor parameters or, for
+  // consumers that put it in the name, from the name, and completes it for
+  // forwarding. function refers to the name of interest.
+  query_status readQuery(const ndn::Interest& interest, uint64_t session_id, QueryDescriptor& descriptor,
+                 boost::string_view& function);
+  // Tells the sender of interest that its query is not answered here.
+  void sendNack(const ndn::Interest& interest);
+  void onData(const ndn::Interest&, const ndn::Data& data, uint64_t session_id);
+  void onNack(const ndn::Interest&, const ndn::lp::Nack& nack, uint64_t session_id);
+  void onTimeout(const ndn::Interest& interest, uint64_t session_id);
+
+  void open_session(const ndn::Interest& interest, uint64_t session_id, size_t expected,
+                    uint64_t timeout_ms);
+  void on_answer(SessionManager::status status, uint64_t session_id);
   void send_data(const boost::system::error_code& error, uint64_t session_id);
-  //この3つはまとめる
-  void convertInterestName(const std::string& interest_name, std::vector<std::string> &interest_name_list);
-  std::vector<std::string> ExtractTargets(const std::string& interest_name);
-  std::vector<std::string> ExtractLocname(const std::string& interest_name);
-  std::string decodeURI(const std::string& uri);
 
+  // Runs f on the worker pool. Parsing, JSON handling, signing and inference
+  // go through here so that the face thread only does packet I/O.
   template <class F> void post_task(F f);
-  boost::asio::io_service& io_service();
+  // Runs f on the face thread. Everything that touches m_ndn_face goes through here.
+  template <class F> void post_face(F f);
 
  private:
   ndn::KeyChain m_key_chain;
@@ -81,29 +102,23 @@ class Producer : boost::noncopyable {
 
   std::unique_ptr<ndn::Face> m_ndn_face_ptr;
 
-  const uint_fast32_t m_num_thread;
-  const uint_fast32_t m_num_queue;
-  uint_fast32_t m_current_queue;
-
-  std::vector<boost::asio::io_service> m_io_service_pool;
-  std::vector<boost::asio::io_service::work> m_worker_pool;
-  std::vector<std::thread> m_thread_pool;
-
-  boost::asio::io_service m_timer_service;
-  std::shared_ptr<boost::asio::io_service::work> m_timer_worker;
+  std::mutex m_key_chain_mutex;
 
   static const uint_fast32_t m_timeout_second = 10000;
 
   std::mt19937_64 m_id_generator;
 
   const uint8_t m_edge_mode;
-  detector_ptr m_detector;
-
-  std::vector<std::string> m_target_name;
-  std::vector<std::string> m_location_name;
-
-  uint64_t m_number_of_arrival_interest;
-  uint64_t m_issued_interest;
-
+  const ndn::util::SegmentFetcher::Options m_fetch_options;
+  const FrameRequest m_frame_request;
+  const std::vector<std::string> m_class_names;  // of the model; targets are indices into it
+  const uint64_t m_class_list;                   // QueryDescriptor::class_list_hash() of it
+  const RegionScope m_scope;                     // region aggregated here and its cells
+  const ndn::Name m_region_prefix;               // routable name of m_scope.region
+  batcher_ptr m_batcher;
+
+  // Declared last so that it is destroyed (and its threads joined) before
+  // anything its tasks may touch.
+  ThreadPool m_pool;
 };
 #endif
@@ -0,0 +1,214 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#include "query-descriptor.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include <ndn-cxx/encoding/block-helpers.hpp>
+
+namespace {
+void encode_spans(uint32_t type, const std::vector<QueryDescriptor::Span> &spans,
+                  ndn::Block &descriptor)
+{
+  for(const QueryDescriptor::Span &span : spans) {
+    ndn::Block block(type);
+    block.push_back(ndn::makeNonNegativeIntegerBlock(query_tlv::Location, span.first));
+    block.push_back(ndn::makeNonNegativeIntegerBlock(query_tlv::Location, span.last));
+    block.encode();
+    descriptor.push_back(block);
+  }
+}
+
+QueryDescriptor::Span decode_span(const ndn::Block &block)
+{
+  block.parse();
+  const auto &elements = block.elements();
+  if(elements.size() != 2 || elements[0].type() != query_tlv::Location ||
+     elements[1].type() != query_tlv::Location) {
+    throw ndn::tlv::Error("a span must hold two Locations");
+  }
+  return {ndn::readNonNegativeInteger(elements[0]), ndn::readNonNegativeInteger(elements[1])};
+}
+}  // namespace
+
+ndn::Block QueryDescriptor::encode() const
+{
+  ndn::Block descriptor(query_tlv::QueryDescriptor);
+  descriptor.push_back(ndn::makeNonNegativeIntegerBlock(query_tlv::EdgeMode, edge_mode));
+  for(const uint64_t location : locations) {
+    descriptor.push_back(ndn::makeNonNegativeIntegerBlock(query_tlv::Location, location));
+  }
+  for(const uint64_t region : regions) {
+    descriptor.push_back(ndn::makeNonNegativeIntegerBlock(query_tlv::Region, region));
+  }
+  encode_spans(query_tlv::LocationRange, ranges, descriptor);
+  encode_spans(query_tlv::LocationBox, boxes, descriptor);
+  for(const uint32_t target : targets) {
+    descriptor.push_back(ndn::makeNonNegativeIntegerBlock(query_tlv::Target, target));
+  }
+  if(class_list != 0) {
+    descriptor.push_back(ndn::makeNonNegativeIntegerBlock(query_tlv::ClassList, class_list));
+  }
+  if(deadline != 0) {
+    descriptor.push_back(ndn::makeNonNegativeIntegerBlock(query_tlv::Deadline, deadline));
+  }
+  if(options != 0) {
+    descriptor.push_back(ndn::makeNonNegativeIntegerBlock(query_tlv::ResultOptions, options));
+  }
+  descriptor.push_back(ndn::makeNonNegativeIntegerBlock(query_tlv::SessionId, session_id));
+  descriptor.encode();
+  return descriptor;
+}
+
+bool QueryDescriptor::decode(const ndn::Block &parameters)
+{
+  // Old edges send the edge mode as a single character; checking the first
+  // byte keeps them from going through the TLV parser.
+  if(parameters.value_size() == 0 || parameters.value()[0] != query_tlv::QueryDescriptor) {
+    return false;
+  }
+
+  try {
+    const ndn::Block descriptor(parameters.value(), parameters.value_size());
+    descriptor.parse();
+
+    QueryDescriptor decoded;
+    for(const ndn::Block &element : descriptor.elements()) {
+      switch(element.type()) {
+        case query_tlv::EdgeMode:
+          decoded.edge_mode = static_cast<uint8_t>(ndn::readNonNegativeInteger(element));
+          break;
+        case query_tlv::Location:
+          decoded.locations.push_back(ndn::readNonNegativeInteger(element));
+          break;
+        case query_tlv::Region:
+          decoded.regions.push_back(ndn::readNonNegativeInteger(element));
+          break;
+        case query_tlv::LocationRange:
+          decoded.ranges.push_back(decode_span(element));
+          break;
+        case query_tlv::LocationBox:
+          decoded.boxes.push_back(decode_span(element));
+          break;
+        case query_tlv::Target:
+          decoded.targets.push_back(static_cast<uint32_t>(ndn::readNonNegativeInteger(element)));
+          break;
+        case query_tlv::ClassList:
+          decoded.class_list = ndn::readNonNegativeInteger(element);
+          break;
+        case query_tlv::Deadline:
+          decoded.deadline = ndn::readNonNegativeInteger(element);
+          break;
+        case query_tlv::ResultOptions:
+          decoded.options = static_cast<uint32_t>(ndn::readNonNegativeInteger(element));
+          break;
+        case query_tlv::SessionId:
+          decoded.session_id = ndn::readNonNegativeInteger(element);
+          break;
+        default:
+          break;
+      }
+    }
+    *this = std::move(decoded);
+    return true;
+  } catch(const ndn::tlv::Error &) {
+    return false;
+  }
+}
+
+bool QueryDescriptor::set_targets(const std::vector<std::string> &names,
+                                  const std::vector<std::string> &class_names)
+{
+  bool is_known = true;
+  targets.clear();
+  for(const std::string &name : names) {
+    const auto it = std::find(class_names.begin(), class_names.end(), name);
+    if(it == class_names.end()) {
+      is_known = false;
+      continue;
+    }
+    targets.push_back(static_cast<uint32_t>(std::distance(class_names.begin(), it)));
+  }
+  return is_known;
+}
+
+std::vector<std::string> QueryDescriptor::target_names(
+    const std::vector<std::string> &class_names) const
+{
+  std::vector<std::string> names;
+  names.reserve(targets.size());
+  for(const uint32_t target : targets) {
+    if(target < class_names.size()) {
+      names.push_back(class_names[target]);
+    }
+  }
+  return names;
+}
+
+uint64_t QueryDescriptor::class_list_hash(const std::vector<std::string> &class_names)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  const auto add = [&hash](uint8_t byte) {
+    hash ^= byte;
+    hash *= 1099511628211ULL;
+  };
+  for(const std::string &name : class_names) {
+    for(const char c : name) {
+      add(static_cast<uint8_t>(c));
+    }
+    add('\n');
+  }
+  return hash;
+}
+
+bool QueryDescriptor::location_code(boost::string_view location, uint64_t &code)
+{
+  // 31 digits fit in 62 bits.
+  if(location.empty() || location.size() > 31 || location.front() == '0') {
+    return false;
+  }
+  code = 0;
+  for(const char digit : location) {
+    if(digit < '0' || digit > '3') {
+      return false;
+    }
+    code = (code << 2) | static_cast<uint64_t>(digit - '0');
+  }
+  return true;
+}
+
+std::string QueryDescriptor::location_name(uint64_t code)
+{
+  std::string name;
+  do {
+    name.push_back(static_cast<char>('0' + (code & 3)));
+    code >>= 2;
+  } while(code != 0);
+  std::reverse(name.begin(), name.end());
+  return name;
+}
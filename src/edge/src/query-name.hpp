@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#ifndef QUERY_NAME_HPP_INC
+#define QUERY_NAME_HPP_INC
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/container/small_vector.hpp>
+#include <boost/utility/string_view.hpp>
+#include <ndn-cxx/name.hpp>
+
+// Query of the crowdsensing service as carried in Interest names, e.g.
+//
+//   /icn2020/edge/#f:detect/#a:[30321,33212] #a:[person,car]
+//
+// The component after the function holds the Z-order locations and the
+// targets, separated by a space. Besides single locations, the list may
+// hold Z-order ranges such as "30300-30333" and bounding boxes given by
+// two opposite corners such as "30300:30333". Queries can also be given as a
+// QueryDescriptor in the parameters of an Interest named up to the function.
+// The edge forwards that form to the worker of every location, with the
+// digits of the location as components and a session id appended:
+//
+//   /3/0/3/2/1/#f:detect/<session id>
+//
+// and to the aggregator of every Z-order prefix a range or box is
+// decomposed into the same way, e.g. /3/0/3/#f:detect/<session id>.
+//
+// The views refer to the components of the parsed ndn::Name, which has to
+// outlive the Query.
+struct Query {
+  using list_type = boost::container::small_vector<boost::string_view, 8>;
+
+  size_t function_index = 0;      // components before it are the routable prefix
+  boost::string_view function;    // e.g. "#f:detect"
+  boost::string_view target_key;  // e.g. "#a:[person,car]"
+  list_type locations;            // e.g. "30321", "33212"
+  list_type targets;              // e.g. "person", "car"
+  boost::string_view session_id;  // empty unless parsed with a session
+
+  static std::vector<std::string> to_strings(const list_type &list);
+};
+
+// Parses query names in a single pass over the name components, without
+// URI encoding and decoding and without copying the strings.
+class QueryName {
+ public:
+  QueryName() = delete;
+
+  // Parses name into query; with_session if the query component is followed
+  // by a session id. A trailing ParametersSha256DigestComponent is ignored.
+  // Returns false if name does not hold a query.
+  static bool parse(const ndn::Name &name, bool with_session, Query &query);
+  // The function component of a name that carries its query in a
+  // QueryDescriptor, i.e. the last component but the parameters digest and,
+  // for names made by forward(), with_session, the session id.
+  static boost::string_view function_of(const ndn::Name &name, bool with_session);
+  // Routable name of location, or of the aggregator of a Z-order prefix.
+  static ndn::Name prefix(boost::string_view location);
+  // Name the edge forwards a query with a QueryDescriptor under to the
+  // worker at location.
+  static ndn::Name forward(boost::string_view function, boost::string_view location,
+                           uint64_t session_id);
+};
+
+#endif
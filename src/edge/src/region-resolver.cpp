@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#include "region-resolver.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+#include "z-order.hpp"
+
+query_status resolve_regions(QueryDescriptor& descriptor, uint8_t edge_mode,
+                             const RegionScope& scope)
+{
+  // Ranges and boxes become the fewest Z-order prefixes that cover them;
+  // a prefix of a single cell is that cell.
+  std::vector<std::pair<uint64_t, size_t>> prefixes;  // and the length of their cells
+  std::vector<uint64_t> decomposed;
+  for(const QueryDescriptor::Span& range : descriptor.ranges) {
+    decomposed.clear();
+    if(!ZOrder::decompose_range(range.first, range.last, scope.max_fanout, decomposed)) {
+      std::cerr << "[WARN] Invalid location range" << std::endl;
+      return query_status::invalid;
+    }
+    for(const uint64_t prefix : decomposed) {
+      prefixes.emplace_back(prefix, ZOrder::length(range.first));
+    }
+    if(prefixes.size() > scope.max_fanout) {
+      return query_status::too_large;
+    }
+  }
+  for(const QueryDescriptor::Span& box : descriptor.boxes) {
+    decomposed.clear();
+    if(!ZOrder::decompose_box(box.first, box.last, scope.max_fanout, decomposed)) {
+      std::cerr << "[WARN] Invalid location box" << std::endl;
+      return query_status::invalid;
+    }
+    for(const uint64_t prefix : decomposed) {
+      prefixes.emplace_back(prefix, ZOrder::length(box.first));
+    }
+    if(prefixes.size() > scope.max_fanout) {
+      return query_status::too_large;
+    }
+  }
+  descriptor.ranges.clear();
+  descriptor.boxes.clear();
+
+  for(const auto& prefix : prefixes) {
+    if(edge_mode == 'c') {
+      // Frames are fetched from every camera, so there is nothing to aggregate.
+      ZOrder::expand(prefix.first, prefix.second, scope.max_fanout, descriptor.locations);
+      if(descriptor.locations.size() > scope.max_fanout) {
+        return query_status::too_large;
+      }
+    } else if(ZOrder::length(prefix.first) == prefix.second) {
+      descriptor.locations.push_back(prefix.first);
+    } else {
+      descriptor.regions.push_back(prefix.first);
+    }
+  }
+  if(edge_mode == 'c' && !descriptor.regions.empty()) {
+    std::cerr << "[WARN] Regions are not supported in cloud mode" << std::endl;
+    descriptor.regions.clear();
+  }
+
+  // Regions that overlap ours are answered by our own cells, as far as they
+  // reach.
+  if(scope.region != 0) {
+    std::vector<uint64_t> regions;
+    for(const uint64_t region : descriptor.regions) {
+      const bool is_inside = ZOrder::covers(scope.region, region);
+      if(!is_inside && !ZOrder::covers(region, scope.region)) {
+        regions.push_back(region);
+        continue;
+      }
+      for(const uint64_t cell : scope.cells) {
+        if(ZOrder::covers(region, cell)) {
+          descriptor.locations.push_back(cell);
+        }
+      }
+      // The rest of a larger region is the siblings of our region and of
+      // each of its ancestors below that region.
+      for(uint64_t node = scope.region; !is_inside && node != region; node >>= 2) {
+        const uint64_t parent = node >> 2;
+        for(uint64_t digit = 0; digit < 4; ++digit) {
+          const uint64_t sibling = (parent << 2) | digit;
+          if(sibling != node) {
+            regions.push_back(sibling);
+          }
+        }
+      }
+    }
+    descriptor.regions.swap(regions);
+  }
+
+  std::sort(descriptor.locations.begin(), descriptor.locations.end());
+  descriptor.locations.erase(std::unique(descriptor.locations.begin(), descriptor.locations.end()),
+                             descriptor.locations.end());
+  std::sort(descriptor.regions.begin(), descriptor.regions.end());
+  descriptor.regions.erase(std::unique(descriptor.regions.begin(), descriptor.regions.end()),
+                           descriptor.regions.end());
+  // Explicit locations count as well, so that no query is sent to more
+  // workers than configured, whichever way it names them.
+  if(descriptor.locations.size() + descriptor.regions.size() > scope.max_fanout) {
+    return query_status::too_large;
+  }
+  return query_status::ok;
+}
@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#ifndef REGION_RESOLVER_HPP_INC
+#define REGION_RESOLVER_HPP_INC
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "query-descriptor.hpp"
+
+// The part of the Z-order quadtree an edge answers for: the prefix it
+// aggregates, if any, and the cells of the workers below it.
+struct RegionScope {
+  uint64_t region = 0;  // Z-order prefix aggregated here, or 0
+  std::vector<uint64_t> cells;
+  size_t max_fanout = 256;  // Interests forwarded per query at most
+};
+
+enum class query_status { ok, invalid, too_large };
+
+// Decomposes the ranges and boxes of descriptor into the locations and
+// regions it is forwarded to. In cloud mode (edge_mode 'c') regions are
+// expanded into their cells, as frames are fetched from every camera.
+//
+// A region within scope.region is answered by the cells below it. A region
+// containing scope.region takes all cells plus the quadrants next to
+// scope.region on the way up to it, which their own aggregators answer.
+// Queries that would be forwarded to more than scope.max_fanout workers and
+// aggregators are too large.
+query_status resolve_regions(QueryDescriptor& descriptor, uint8_t edge_mode,
+                             const RegionScope& scope);
+
+#endif
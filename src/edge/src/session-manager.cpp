@@ -29,6 +29,7 @@
 #include <ndn-cxx/data.hpp>
 #include <ndn-cxx/name.hpp>
 
+#include <algorithm>
 #include <cinttypes>
 #include <fcopss/log.hpp>
 #include <ostream>
@@ -36,34 +37,7 @@
 
 #include <boost/asio.hpp>
 
-class Session {
- public:
-  Session() = delete;
-  Session(uint64_t id_, std::shared_ptr<ndn::Data> data_,
-          std::shared_ptr<boost::asio::steady_timer> timer_)
-      : session_id(id_), data_ptr(data_), timer_ptr(timer_)
-  {
-  }
-  ~Session() noexcept = default;
-
-  Session(const Session &other) = default;
-  Session &operator=(const Session &other) = default;
-  Session(Session &&other) noexcept = default;
-  Session &operator=(Session &&other) noexcept = default;
-
-  // void append_payload(const std::string &str);
-
- public:
-  const uint64_t session_id;
-  std::shared_ptr<ndn::Data> data_ptr;
-  std::shared_ptr<boost::asio::steady_timer> timer_ptr;
-  std::vector<uint8_t> buffer;
-};
-
-// void Session::append_payload(const std::string &str)
-// {
-//   buffer.append(str);
-// }
+constexpr size_t SessionManager::num_shards;
 
 SessionManager &SessionManager::instance()
 {
@@ -71,68 +45,117 @@ SessionManager &SessionManager::instance()
   return object;
 }
 
+SessionManager::Shard &SessionManager::shard(key_type key)
+{
+  // Session IDs are drawn from a 64-bit Mersenne Twister, so the low bits are
+  // already well distributed.
+  return m_shards[key % num_shards];
+}
+
 void SessionManager::add(key_type key, std::shared_ptr<ndn::Data> data_packet,
-                         std::shared_ptr<boost::asio::steady_timer> timer)
+                         std::shared_ptr<boost::asio::steady_timer> timer, size_t expected)
 {
-  std::lock_guard<mutex_type> lock(m_mutex);
-  if(m_hash_table.find(key) == m_hash_table.end()) {
-    m_hash_table.emplace(key, session_ptr(new session_type(key, data_packet, timer)));
-  }
+  session_ptr session(new session_type(key, data_packet, timer, expected));
+  Shard &s = shard(key);
+  std::lock_guard<mutex_type> lock(s.mutex);
+  s.hash_table.emplace(key, session);
   return;
 }
 
 SessionManager::session_ptr SessionManager::get(key_type key)
 {
-  std::lock_guard<mutex_type> lock(m_mutex);
-  try {
-    return m_hash_table.at(key);
-  } catch(std::out_of_range &) {
+  Shard &s = shard(key);
+  std::lock_guard<mutex_type> lock(s.mutex);
+  auto it = s.hash_table.find(key);
+  if(it == s.hash_table.end()) {
     return session_ptr();
   }
+  return it->second;
 }
 
 void SessionManager::erase(key_type key)
 {
-  std::lock_guard<mutex_type> lock(m_mutex);
-  m_hash_table.erase(key);
+  Shard &s = shard(key);
+  std::lock_guard<mutex_type> lock(s.mutex);
+  s.hash_table.erase(key);
 }
 
-bool SessionManager::append_payload(key_type key, const uint8_t *value, size_t length)
+SessionManager::session_ptr SessionManager::release(key_type key)
 {
-  std::lock_guard<mutex_type> lock(m_mutex);
+  Shard &s = shard(key);
+  std::lock_guard<mutex_type> lock(s.mutex);
+  auto it = s.hash_table.find(key);
+  if(it == s.hash_table.end()) {
+    return session_ptr();
+  }
+  session_ptr session(std::move(it->second));
+  s.hash_table.erase(it);
+  return session;
+}
+
+SessionManager::status SessionManager::append_payload(key_type key, const uint8_t *value,
+                                                      size_t length)
+{
+  // The shard lock is held only for the lookup; copying the payload is done
+  // under the per-session lock.
   session_ptr data = get(key);
   if(data == nullptr) {
-    INFO("Session (%PRIu64) does not exist.", key);
-    return false;
+    INFO("Session (%" PRIu64 ") does not exist.", key);
+    return status::not_found;
+  }
+  std::lock_guard<std::mutex> lock(data->mutex);
+  // Aggregators without answers send empty payloads, which add no line.
+  if(length > 0) {
+    if(!data->buffer.empty()) {
+      data->buffer.push_back('\n');
+    }
+    data->buffer.insert(data->buffer.end(), value, value + length);
   }
-  std::copy(value, value + length, std::back_inserter(data->buffer));
-  data->buffer.push_back('\n');
-  return true;
+  ++data->received;
+  return (data->received == data->expected) ? status::complete : status::pending;
 }
 
-const std::vector<uint8_t> &SessionManager::buffer(key_type key)
+SessionManager::status SessionManager::append_failure(key_type key)
 {
-  std::lock_guard<mutex_type> lock(m_mutex);
-  return m_hash_table.at(key)->buffer;
+  session_ptr data = get(key);
+  if(data == nullptr) {
+    return status::not_found;
+  }
+  std::lock_guard<std::mutex> lock(data->mutex);
+  ++data->received;
+  ++data->failed;
+  return (data->received == data->expected) ? status::complete : status::pending;
 }
 
 std::shared_ptr<ndn::Data> SessionManager::data_packet(key_type key)
 {
-  std::lock_guard<mutex_type> lock(m_mutex);
   session_ptr data = get(key);
   if(data == nullptr) {
-    INFO("Session (%PRIu64) does not exist.", key);
+    INFO("Session (%" PRIu64 ") does not exist.", key);
     return std::shared_ptr<ndn::Data>();
   }
   return data->data_ptr;
 }
 
+size_t SessionManager::size() const
+{
+  size_t n = 0;
+  for(const Shard &s : m_shards) {
+    std::lock_guard<mutex_type> lock(s.mutex);
+    n += s.hash_table.size();
+  }
+  return n;
+}
+
 void SessionManager::dump(std::ostream &os) const
 {
-  std::for_each(m_hash_table.begin(), m_hash_table.end(),
-                [&os](const std::pair<key_type, session_ptr> &p) {
-                  os << '{' << p.first << ',' << p.second->data_ptr->getName().toUri().c_str()
-                     << "}, " << std::endl;
-                });
+  for(const Shard &s : m_shards) {
+    std::lock_guard<mutex_type> lock(s.mutex);
+    std::for_each(s.hash_table.begin(), s.hash_table.end(),
+                  [&os](const std::pair<const key_type, session_ptr> &p) {
+                    os << '{' << p.first << ',' << p.second->data_ptr->getName().toUri().c_str()
+                       << "}, " << std::endl;
+                  });
+  }
   return;
 }
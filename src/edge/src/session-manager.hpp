@@ -28,6 +28,8 @@
 #define SESSION_MANAGER_HPP_INC
 
 #include <boost/asio/steady_timer.hpp>
+#include <array>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <mutex>
@@ -36,20 +38,65 @@
 #include <thread>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace ndn {
 class Name;
 class Data;
 };  // namespace ndn
-class Session;
+
+class Session {
+ public:
+  Session() = delete;
+  Session(uint64_t id_, std::shared_ptr<ndn::Data> data_,
+          std::shared_ptr<boost::asio::steady_timer> timer_, size_t expected_)
+      : session_id(id_),
+        data_ptr(data_),
+        timer_ptr(timer_),
+        expected(expected_),
+        received(0),
+        failed(0)
+  {
+  }
+  ~Session() noexcept = default;
+
+  Session(const Session &other) = delete;
+  Session &operator=(const Session &other) = delete;
+
+ public:
+  const uint64_t session_id;
+  std::shared_ptr<ndn::Data> data_ptr;
+  // Completes the session when it expires, see Producer::send_data().
+  std::shared_ptr<boost::asio::steady_timer> timer_ptr;
+
+  // Fan-in state of this query: the number of re-invoked Interests, how many of
+  // them have been answered, and how many of those answers were Nacks/timeouts.
+  const size_t expected;
+  size_t received;
+  size_t failed;
+
+  // Partial results gathered so far, one line per answer. Lines are
+  // separated, not terminated, by newlines, so that the answer of an
+  // aggregator can be appended to the session of the edge that asked it as
+  // it is.
+  std::vector<uint8_t> buffer;
+  // Guards received, failed and buffer. Each session has its own lock so that
+  // payloads of different sessions are appended without contending with each
+  // other.
+  std::mutex mutex;
+};
 
 class SessionManager {
  public:
   using key_type = uint64_t;
   using session_type = Session;
   using session_ptr = std::shared_ptr<Session>;
-  using value_type = std::pair<key_type, session_type>;
-  using mutex_type = std::recursive_mutex;
+  using value_type = std::pair<key_type, session_ptr>;
+  using mutex_type = std::mutex;
+
+  enum class status { not_found, pending, complete };
+
+  static constexpr size_t num_shards = 64;
 
  private:
   SessionManager() = default;
@@ -64,23 +111,38 @@ class SessionManager {
   static SessionManager &instance();
 
   void add(key_type key, std::shared_ptr<ndn::Data> data_packet,
-           std::shared_ptr<boost::asio::steady_timer> timer);
+           std::shared_ptr<boost::asio::steady_timer> timer, size_t expected);
   void erase(key_type key);
 
-  bool append_payload(key_type key, const uint8_t *value, size_t length);
-  const std::vector<uint8_t> &buffer(key_type key);
+  // Records one answer for the session and reports whether all re-invoked
+  // Interests of the session have now been answered.
+  status append_payload(key_type key, const uint8_t *value, size_t length);
+  // Same as append_payload() for a re-invoked Interest that was Nacked or timed out.
+  status append_failure(key_type key);
+
+  // Removes the session from the table and hands it over to the caller.
+  // Only one caller can obtain a given session, so this is also used to decide
+  // who completes it (the last arriving Data or the timer).
+  session_ptr release(key_type key);
 
   std::shared_ptr<ndn::Data> data_packet(key_type key);
 
+  size_t size() const;
   void dump(std::ostream &os) const;
 
  private:
+  // A shard is aligned to a cache line so that locking one shard does not
+  // invalidate the line holding its neighbor's mutex.
+  struct alignas(64) Shard {
+    mutable mutex_type mutex;
+    std::unordered_map<key_type, session_ptr> hash_table;
+  };
+
+  Shard &shard(key_type key);
   session_ptr get(key_type key);
 
  private:
-  std::unordered_map<key_type, session_ptr> m_hash_table;
-  // std::mutex m_mutex;
-  std::recursive_mutex m_mutex;
+  std::array<Shard, num_shards> m_shards;
 };
 
 #endif
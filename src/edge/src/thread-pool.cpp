@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#include "thread-pool.hpp"
+
+#include <exception>
+#include <iostream>
+#include <utility>
+
+namespace {
+// Pool and queue index of the calling thread, if it is a pool worker.
+thread_local const ThreadPool* t_pool = nullptr;
+thread_local size_t t_index = 0;
+}  // namespace
+
+ThreadPool::ThreadPool(size_t num_threads)
+    : m_queues(),
+      m_threads(),
+      m_next_queue(0),
+      m_pending(0),
+      m_sleeping(0),
+      m_run(true),
+      m_executed(0),
+      m_stolen(0)
+{
+  for(size_t n = 0; n < num_threads; ++n) {
+    m_queues.emplace_back(new Queue());
+  }
+  for(size_t n = 0; n < num_threads; ++n) {
+    m_threads.emplace_back([this, n] { this->run(n); });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_idle_mutex);
+    m_run = false;
+  }
+  m_idle.notify_all();
+  for(auto& thread : m_threads) {
+    if(thread.joinable()) thread.join();
+  }
+}
+
+void ThreadPool::post(task_type task)
+{
+  if(m_queues.empty()) {
+    execute(task);
+    return;
+  }
+
+  size_t index = (t_pool == this)
+                     ? t_index
+                     : m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+  // The pending count is raised before the task becomes visible and before the
+  // sleeper count is read. A worker raises the sleeper count before its last
+  // look at the pending count, so either it sees this task or we see it asleep.
+  m_pending.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+    m_queues[index]->tasks.push_back(std::move(task));
+  }
+  if(m_sleeping.load() > 0) {
+    std::lock_guard<std::mutex> lock(m_idle_mutex);
+    m_idle.notify_one();
+  }
+}
+
+void ThreadPool::execute(task_type& task)
+{
+  // An exception escaping a worker would terminate the process, and with it
+  // every other query in flight.
+  try {
+    task();
+  } catch(const std::exception& e) {
+    std::cerr << "[WARN] Task of the worker pool failed: " << e.what() << std::endl;
+  } catch(...) {
+    std::cerr << "[WARN] Task of the worker pool failed" << std::endl;
+  }
+  m_executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ThreadPool::pop(size_t index, task_type& task)
+{
+  Queue& queue = *m_queues[index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if(queue.tasks.empty()) {
+    return false;
+  }
+  task = std::move(queue.tasks.back());
+  queue.tasks.pop_back();
+  return true;
+}
+
+bool ThreadPool::steal(size_t index, task_type& task)
+{
+  // Busy queues are skipped at first, and waited for only if no other queue
+  // has a task. Giving up on them instead would have the caller spin, as the
+  // pending count tells it there is work.
+  bool is_busy = false;
+  for(int pass = 0; pass < 2; ++pass) {
+    for(size_t i = 1; i < m_queues.size(); ++i) {
+      Queue& queue = *m_queues[(index + i) % m_queues.size()];
+      std::unique_lock<std::mutex> lock(queue.mutex, std::defer_lock);
+      if(pass == 0 && !lock.try_lock()) {
+        is_busy = true;
+        continue;
+      } else if(pass == 1) {
+        lock.lock();
+      }
+      if(queue.tasks.empty()) {
+        continue;
+      }
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      m_stolen.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    if(!is_busy) {
+      break;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::run(size_t index)
+{
+  t_pool = this;
+  t_index = index;
+
+  task_type task;
+  while(true) {
+    if(pop(index, task) || steal(index, task)) {
+      m_pending.fetch_sub(1);
+      execute(task);
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_idle_mutex);
+    m_sleeping.fetch_add(1);
+    m_idle.wait(lock, [this] { return !m_run || m_pending.load() > 0; });
+    m_sleeping.fetch_sub(1);
+    if(!m_run && m_pending.load() == 0) {
+      break;
+    }
+  }
+  return;
+}
@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#ifndef THREAD_POOL_HPP_INC
+#define THREAD_POOL_HPP_INC
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+// Work-stealing thread pool.
+//
+// Every worker owns a task queue. A task posted from a worker thread goes to
+// the back of that worker's own queue and is popped LIFO, which keeps follow-up
+// work on the core that produced it. Tasks posted from other threads (e.g. the
+// NDN face thread) are spread round-robin. A worker whose queue is empty steals
+// from the front of the other queues before going to sleep.
+//
+// With zero threads, post() runs the task on the calling thread. Exceptions
+// thrown by tasks are logged and dropped.
+class ThreadPool : boost::noncopyable {
+ public:
+  using task_type = std::function<void()>;
+
+  explicit ThreadPool(size_t num_threads);
+  ~ThreadPool();
+
+  void post(task_type task);
+  size_t size() const { return m_threads.size(); }
+
+  uint64_t executed() const { return m_executed.load(std::memory_order_relaxed); }
+  uint64_t stolen() const { return m_stolen.load(std::memory_order_relaxed); }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<task_type> tasks;
+  };
+
+  void run(size_t index);
+  void execute(task_type& task);
+  bool pop(size_t index, task_type& task);
+  bool steal(size_t index, task_type& task);
+
+ private:
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  std::vector<std::thread> m_threads;
+
+  std::atomic<size_t> m_next_queue;
+  std::atomic<int64_t> m_pending;
+  std::atomic<size_t> m_sleeping;
+  std::atomic<bool> m_run;
+
+  std::mutex m_idle_mutex;
+  std::condition_variable m_idle;
+
+  std::atomic<uint64_t> m_executed;
+  std::atomic<uint64_t> m_stolen;
+};
+
+#endif
@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#include "z-order.hpp"
+
+#include <algorithm>
+
+namespace {
+// Coordinates of code below its root, in cells of its length.
+void coordinates(uint64_t code, size_t length, uint32_t &x, uint32_t &y)
+{
+  x = 0;
+  y = 0;
+  for(size_t level = 1; level < length; ++level) {
+    const uint64_t digit = (code >> (2 * (length - 1 - level))) & 3;
+    x = (x << 1) | static_cast<uint32_t>(digit & 1);
+    y = (y << 1) | static_cast<uint32_t>(digit >> 1);
+  }
+}
+
+// Visits the quadrant node, whose lower corner is (x, y) and which is size
+// cells wide, and splits it until its quadrants are inside or outside of
+// the box [x0, x1] x [y0, y1].
+void cover(uint64_t node, uint32_t x, uint32_t y, uint32_t size, uint32_t x0, uint32_t y0,
+           uint32_t x1, uint32_t y1, size_t limit, std::vector<uint64_t> &prefixes)
+{
+  if(prefixes.size() > limit || x > x1 || y > y1 || x + size - 1 < x0 || y + size - 1 < y0) {
+    return;
+  }
+  if(x0 <= x && x + size - 1 <= x1 && y0 <= y && y + size - 1 <= y1) {
+    prefixes.push_back(node);
+    return;
+  }
+  const uint32_t half = size / 2;
+  for(uint64_t digit = 0; digit < 4; ++digit) {
+    cover((node << 2) | digit, x + (digit & 1) * half, y + (digit >> 1) * half, half, x0, y0, x1,
+          y1, limit, prefixes);
+  }
+}
+}  // namespace
+
+size_t ZOrder::length(uint64_t code)
+{
+  size_t digits = 1;
+  while(code > 3) {
+    code >>= 2;
+    ++digits;
+  }
+  return digits;
+}
+
+bool ZOrder::covers(uint64_t prefix, uint64_t code)
+{
+  const size_t prefix_length = length(prefix);
+  const size_t code_length = length(code);
+  return prefix_length <= code_length && (code >> (2 * (code_length - prefix_length))) == prefix;
+}
+
+bool ZOrder::decompose_range(uint64_t first, uint64_t last, size_t limit,
+                             std::vector<uint64_t> &prefixes)
+{
+  const size_t digits = length(first);
+  if(first > last || length(last) != digits) {
+    return false;
+  }
+  // Takes the largest aligned quadrant that starts at first and ends at or
+  // before last; the root digit is always kept.
+  for(;;) {
+    size_t dropped = 0;
+    while(dropped + 1 < digits) {
+      const uint64_t span = uint64_t(1) << (2 * (dropped + 1));
+      if((first & (span - 1)) != 0 || first + span - 1 > last) {
+        break;
+      }
+      ++dropped;
+    }
+    prefixes.push_back(first >> (2 * dropped));
+    const uint64_t span = uint64_t(1) << (2 * dropped);
+    if(first + span - 1 == last || prefixes.size() > limit) {
+      return true;
+    }
+    first += span;
+  }
+}
+
+bool ZOrder::decompose_box(uint64_t corner1, uint64_t corner2, size_t limit,
+                           std::vector<uint64_t> &prefixes)
+{
+  const size_t digits = length(corner1);
+  const uint64_t root = corner1 >> (2 * (digits - 1));
+  if(length(corner2) != digits || (corner2 >> (2 * (digits - 1))) != root) {
+    return false;
+  }
+  uint32_t x1, y1, x2, y2;
+  coordinates(corner1, digits, x1, y1);
+  coordinates(corner2, digits, x2, y2);
+  cover(root, 0, 0, uint32_t(1) << (digits - 1), std::min(x1, x2), std::min(y1, y2),
+        std::max(x1, x2), std::max(y1, y2), limit, prefixes);
+  return true;
+}
+
+void ZOrder::expand(uint64_t prefix, size_t length, size_t limit, std::vector<uint64_t> &cells)
+{
+  const size_t prefix_length = ZOrder::length(prefix);
+  if(prefix_length > length) {
+    return;
+  }
+  const size_t shift = 2 * (length - prefix_length);
+  const uint64_t first = prefix << shift;
+  const uint64_t last = first + ((uint64_t(1) << shift) - 1);
+  for(uint64_t cell = first; cell <= last && cells.size() <= limit; ++cell) {
+    cells.push_back(cell);
+  }
+}
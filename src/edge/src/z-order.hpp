@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#ifndef Z_ORDER_HPP_INC
+#define Z_ORDER_HPP_INC
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Arithmetic on the location codes of QueryDescriptor. The first digit of a
+// location names the root of a quadtree and every further digit one of the
+// four quadrants of its parent, y * 2 + x, so that locations sorted as
+// numbers of the same length are in Z-order. A code shorter than the cells
+// is the prefix of all cells in its quadrant, e.g. "303" of "30321".
+class ZOrder {
+ public:
+  ZOrder() = delete;
+
+  // Number of digits of code.
+  static size_t length(uint64_t code);
+  // Whether code is prefix or one of the locations below it.
+  static bool covers(uint64_t prefix, uint64_t code);
+
+  // The functions below stop appending as soon as the output holds more than
+  // limit entries, so that a query cannot make them run away; callers
+  // check for that by its size.
+
+  // Appends the fewest prefixes whose quadrants together are exactly the
+  // cells first to last in Z-order. Both have to be of the same length and
+  // first must not be after last.
+  static bool decompose_range(uint64_t first, uint64_t last, size_t limit,
+                              std::vector<uint64_t> &prefixes);
+  // Same for the cells of the rectangle with the opposite corners corner1
+  // and corner2, which have to be of the same length and root. The number
+  // of prefixes grows with the perimeter of the rectangle, not its area.
+  static bool decompose_box(uint64_t corner1, uint64_t corner2, size_t limit,
+                            std::vector<uint64_t> &prefixes);
+  // Appends the cells of the given length below prefix.
+  static void expand(uint64_t prefix, size_t length, size_t limit, std::vector<uint64_t> &cells);
+};
+
+#endif
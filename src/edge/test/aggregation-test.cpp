@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+// Answers a box query through two levels of aggregation: the edge asks a
+// worker of its own and the aggregator of a region, which joins the
+// answers of its cells. Every line of the answer the consumer gets has to
+// be one JSON object, which it was not while SessionManager terminated
+// every answer, including the already terminated ones of aggregators,
+// with a newline.
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <ndn-cxx/data.hpp>
+
+#include "query-descriptor.hpp"
+#include "query-name.hpp"
+#include "region-resolver.hpp"
+#include "session-manager.hpp"
+
+namespace {
+int failures = 0;
+
+void check(bool condition, const char *what)
+{
+  if(!condition) {
+    std::cerr << "FAILED: " << what << std::endl;
+    ++failures;
+  }
+}
+
+uint64_t code_of(const std::string &location)
+{
+  uint64_t code = 0;
+  QueryDescriptor::location_code(location, code);
+  return code;
+}
+
+void open(boost::asio::io_service &io, uint64_t session_id, size_t expected)
+{
+  std::shared_ptr<boost::asio::steady_timer> timer(new boost::asio::steady_timer(io));
+  timer->expires_from_now(std::chrono::seconds(1));
+  SessionManager::instance().add(session_id, std::make_shared<ndn::Data>(), timer, expected);
+}
+
+SessionManager::status answer(uint64_t session_id, const std::string &payload)
+{
+  return SessionManager::instance().append_payload(
+      session_id, reinterpret_cast<const uint8_t *>(payload.data()), payload.size());
+}
+
+std::string answer_of(uint64_t session_id)
+{
+  SessionManager::session_ptr session = SessionManager::instance().release(session_id);
+  return session ? std::string(session->buffer.begin(), session->buffer.end()) : std::string();
+}
+
+std::string worker_answer(const std::string &location)
+{
+  return "{\"isFound\": true, \"location\": \"" + location + "\", \"target\": \"person\"}\n"
+         "{\"isFound\": false, \"location\": \"" + location + "\", \"target\": \"car\"}";
+}
+}  // namespace
+
+int main()
+{
+  boost::asio::io_service io;
+
+  // The box 30300:30313 is the quadrants 3030 and 3031, i.e. the regions of
+  // two aggregators, one of which, 3031, has no workers. The edge has a
+  // worker at 33212 besides.
+  RegionScope edge;
+  edge.max_fanout = 16;
+  QueryDescriptor query;
+  query.boxes.push_back(QueryDescriptor::Span{code_of("30300"), code_of("30313")});
+  query.locations.push_back(code_of("33212"));
+  check(resolve_regions(query, 'e', edge) == query_status::ok, "box is resolved");
+  check(query.locations == std::vector<uint64_t>{code_of("33212")}, "edge asks its worker");
+  check(query.regions == std::vector<uint64_t>{code_of("3030"), code_of("3031")},
+        "box is forwarded to the aggregators of its quadrants");
+
+  // The aggregator of 3030 is asked under its region with the session of
+  // the edge, and answers from the cells of its own below it.
+  const ndn::Name forwarded = QueryName::forward("#f:detect", "3030", 1);
+  check(QueryName::function_of(forwarded, true) == "#f:detect",
+        "forwarded query keeps its function");
+  RegionScope aggregator;
+  aggregator.region = code_of("3030");
+  aggregator.cells = {code_of("30300"), code_of("30301")};
+  QueryDescriptor aggregated_query;
+  aggregated_query.regions.assign(1, code_of("3030"));
+  check(resolve_regions(aggregated_query, 'e', aggregator) == query_status::ok,
+        "forwarded query is resolved");
+  check(aggregated_query.locations == aggregator.cells && aggregated_query.regions.empty(),
+        "aggregator asks its cells and forwards nothing");
+  const std::vector<uint64_t> &asked = aggregated_query.locations;
+
+  const uint64_t edge_session = 1, aggregator_session = 2, empty_session = 3;
+  open(io, aggregator_session, asked.size());
+  check(answer(aggregator_session, worker_answer("30300")) == SessionManager::status::pending,
+        "aggregator waits for its second cell");
+  check(answer(aggregator_session, worker_answer("30301")) == SessionManager::status::complete,
+        "aggregator is complete with both cells");
+  const std::string aggregated = answer_of(aggregator_session);
+
+  open(io, empty_session, 0);
+  const std::string empty = answer_of(empty_session);
+  check(empty.empty(), "aggregator without cells answers nothing");
+
+  open(io, edge_session, 3);
+  answer(edge_session, worker_answer("33212"));
+  answer(edge_session, aggregated);
+  check(answer(edge_session, empty) == SessionManager::status::complete,
+        "edge is complete with the worker and both aggregators");
+  const std::string result = answer_of(edge_session);
+
+  std::istringstream lines(result);
+  std::string line;
+  size_t count = 0;
+  while(std::getline(lines, line)) {
+    ++count;
+    check(line.size() > 2 && line.front() == '{' && line.back() == '}',
+          "every line of the answer is a JSON object");
+  }
+  check(count == 6, "answer has a line per target of each of the three workers");
+  check(!result.empty() && result.back() != '\n', "answer does not end with an empty line");
+
+  if(failures != 0) {
+    return EXIT_FAILURE;
+  }
+  std::cerr << "aggregation-test: OK" << std::endl;
+  return EXIT_SUCCESS;
+}
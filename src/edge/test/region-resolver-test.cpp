@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+// Queries for regions that overlap the one an edge aggregates are answered
+// from the cells of its workers, and for the rest of a region containing
+// it forwarded to the aggregators of the neighbouring quadrants.
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "query-descriptor.hpp"
+#include "region-resolver.hpp"
+
+namespace {
+int failures = 0;
+
+void check(bool condition, const char *what)
+{
+  if(!condition) {
+    std::cerr << "FAILED: " << what << std::endl;
+    ++failures;
+  }
+}
+
+uint64_t code_of(const std::string &location)
+{
+  uint64_t code = 0;
+  QueryDescriptor::location_code(location, code);
+  return code;
+}
+
+std::vector<uint64_t> codes_of(const std::vector<std::string> &locations)
+{
+  std::vector<uint64_t> codes;
+  for(const std::string &location : locations) {
+    codes.push_back(code_of(location));
+  }
+  return codes;
+}
+
+// Resolves a query for region at the aggregator of scope.
+QueryDescriptor resolve(const std::string &region, const RegionScope &scope,
+                        query_status expected = query_status::ok)
+{
+  QueryDescriptor descriptor;
+  descriptor.regions.push_back(code_of(region));
+  check(resolve_regions(descriptor, 'e', scope) == expected, "query is resolved as expected");
+  return descriptor;
+}
+}  // namespace
+
+int main()
+{
+  RegionScope scope;
+  scope.region = code_of("30");
+  scope.cells = codes_of({"30001", "30123", "30300", "30301"});
+  scope.max_fanout = 16;
+
+  QueryDescriptor equal = resolve("30", scope);
+  check(equal.locations == scope.cells, "region of our own is all of our cells");
+  check(equal.regions.empty(), "region of our own is not forwarded");
+
+  QueryDescriptor inside = resolve("303", scope);
+  check(inside.locations == codes_of({"30300", "30301"}), "region inside ours is its cells");
+  check(inside.regions.empty(), "region inside ours is not forwarded");
+
+  QueryDescriptor containing = resolve("3", scope);
+  check(containing.locations == scope.cells, "region containing ours takes all of our cells");
+  check(containing.regions == codes_of({"31", "32", "33"}),
+        "rest of a region containing ours is forwarded to our siblings");
+
+  scope.region = code_of("302");
+  scope.cells = codes_of({"30200", "30233"});
+  QueryDescriptor above = resolve("3", scope);
+  check(above.locations == scope.cells, "region further up takes all of our cells");
+  check(above.regions == codes_of({"31", "32", "33", "300", "301", "303"}),
+        "rest of a region further up is forwarded to the siblings on the way up");
+
+  QueryDescriptor separate = resolve("31", scope);
+  check(separate.locations.empty(), "separate region takes none of our cells");
+  check(separate.regions == codes_of({"31"}), "separate region is forwarded as it is");
+
+  scope.max_fanout = 5;
+  resolve("3", scope, query_status::too_large);
+
+  if(failures != 0) {
+    return EXIT_FAILURE;
+  }
+  std::cerr << "region-resolver-test: OK" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+// Tasks that throw must not take the pool, or the process, down with them:
+// the tasks posted after them still run, on pool threads as well as on the
+// posting thread of a pool without threads.
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+
+#include "thread-pool.hpp"
+
+namespace {
+int failures = 0;
+
+void check(bool condition, const char *what)
+{
+  if(!condition) {
+    std::cerr << "FAILED: " << what << std::endl;
+    ++failures;
+  }
+}
+
+void run(size_t num_threads)
+{
+  const size_t num_tasks = 100;
+  std::atomic<size_t> done(0);
+  std::promise<void> all_done;
+  {
+    ThreadPool pool(num_threads);
+    pool.post([] { throw std::runtime_error("task failed"); });
+    pool.post([] { throw 42; });
+    for(size_t i = 0; i < num_tasks; ++i) {
+      pool.post([&done, &all_done] {
+        if(done.fetch_add(1) + 1 == num_tasks) {
+          all_done.set_value();
+        }
+      });
+    }
+    all_done.get_future().wait();
+  }
+  check(done == num_tasks, "tasks after failed ones run");
+}
+}  // namespace
+
+int main()
+{
+  run(0);
+  run(4);
+
+  if(failures != 0) {
+    return EXIT_FAILURE;
+  }
+  std::cerr << "thread-pool-test: OK" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+// Time the worker takes to answer the segment Interests of a cloud-mode
+// frame, before and after SegmentStore. Before, every Interest, first ones
+// and retransmissions alike, signed its segment again with the default
+// identity; now the segments are signed once when the frame is stored and
+// looked up by SegmentStore::find. Both sides wire-encode what they would
+// put to the face, and neither logs, which would dominate either side.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <ndn-cxx/data.hpp>
+#include <ndn-cxx/interest.hpp>
+#include <ndn-cxx/name.hpp>
+#include <ndn-cxx/security/key-chain.hpp>
+#include <ndn-cxx/security/signing-info.hpp>
+
+#include "segment-store.hpp"
+
+namespace {
+// A raw 416x416 BGR frame in segments of the default size, each of which
+// is asked for num_rounds times, as retransmissions would.
+const size_t frame_size = 416 * 416 * 3;
+const size_t segment_size = 8000;
+const size_t num_frames = 10;
+const size_t num_rounds = 2;
+
+double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+std::vector<ndn::Interest> segment_interests(const ndn::Name &versioned_prefix,
+                                             size_t num_segments)
+{
+  std::vector<ndn::Interest> interests;
+  for(size_t round = 0; round < num_rounds; ++round) {
+    for(size_t i = 0; i < num_segments; ++i) {
+      interests.emplace_back(ndn::Name(versioned_prefix).appendSegment(i));
+    }
+  }
+  return interests;
+}
+
+// Returns the bytes put, so that the work is not optimized away.
+size_t before(const std::vector<uint8_t> &frame, const ndn::Name &versioned_prefix,
+              ndn::KeyChain &key_chain, double &store_ms, double &serve_ms)
+{
+  auto start = std::chrono::steady_clock::now();
+  const size_t num_segments = (frame.size() + segment_size - 1) / segment_size;
+  const auto final_block_id = ndn::name::Component::fromSegment(num_segments - 1);
+  std::vector<std::shared_ptr<ndn::Data>> store;
+  for(size_t i = 0; i < num_segments; ++i) {
+    const size_t offset = i * segment_size;
+    auto data = std::make_shared<ndn::Data>(ndn::Name(versioned_prefix).appendSegment(i));
+    data->setFreshnessPeriod(ndn::time::seconds(10));
+    data->setContent(frame.data() + offset, std::min(segment_size, frame.size() - offset));
+    data->setFinalBlock(final_block_id);
+    store.push_back(data);
+  }
+  store_ms += elapsed_ms(start);
+
+  const std::vector<ndn::Interest> interests = segment_interests(versioned_prefix, num_segments);
+  size_t bytes = 0;
+  start = std::chrono::steady_clock::now();
+  for(const ndn::Interest &interest : interests) {
+    const size_t segment = static_cast<size_t>(interest.getName()[-1].toSegment());
+    ndn::Data &data = *store[segment];
+    key_chain.sign(data);
+    bytes += data.wireEncode().size();
+  }
+  serve_ms += elapsed_ms(start);
+  return bytes;
+}
+
+size_t after(const std::vector<uint8_t> &frame, const ndn::Name &versioned_prefix,
+             ndn::KeyChain &key_chain, SegmentStore &store, double &store_ms, double &serve_ms)
+{
+  auto start = std::chrono::steady_clock::now();
+  SegmentStore::segments_type segments =
+      SegmentStore::segment(versioned_prefix, frame.data(), frame.size(), segment_size,
+                            key_chain, ndn::security::SigningInfo());
+  const size_t num_segments = segments.size();
+  store.insert(versioned_prefix, std::move(segments));
+  store_ms += elapsed_ms(start);
+
+  const std::vector<ndn::Interest> interests = segment_interests(versioned_prefix, num_segments);
+  size_t bytes = 0;
+  start = std::chrono::steady_clock::now();
+  for(const ndn::Interest &interest : interests) {
+    const ndn::Data *data = store.find(interest);
+    if(data != nullptr) {
+      bytes += data->wireEncode().size();
+    }
+  }
+  serve_ms += elapsed_ms(start);
+  return bytes;
+}
+}  // namespace
+
+int main()
+{
+  ndn::KeyChain key_chain("pib-memory:", "tpm-memory:");
+  key_chain.createIdentity(ndn::Name("/icn2020/worker"));
+  SegmentStore store{SegmentStore::Limits()};
+
+  std::vector<uint8_t> frame(frame_size);
+  for(size_t i = 0; i < frame.size(); ++i) {
+    frame[i] = static_cast<uint8_t>(i * 7);
+  }
+  const size_t num_interests =
+      num_frames * num_rounds * ((frame_size + segment_size - 1) / segment_size);
+
+  double before_store_ms = 0, before_serve_ms = 0, after_store_ms = 0, after_serve_ms = 0;
+  size_t before_bytes = 0, after_bytes = 0;
+  for(size_t i = 0; i < num_frames; ++i) {
+    const ndn::Name versioned_prefix = ndn::Name("/icn2020/worker/frame").appendVersion(i + 1);
+    before_bytes += before(frame, versioned_prefix, key_chain, before_store_ms, before_serve_ms);
+    after_bytes += after(frame, versioned_prefix, key_chain, store, after_store_ms,
+                         after_serve_ms);
+  }
+  if(before_bytes == 0 || after_bytes == 0) {
+    std::cerr << "FAILED: no segments were served" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  boost::format row_format(
+      "%1%:%|10t|%2$.1f ms to store%|30t|%3$.1f ms to serve%|50t|%4$.0f Interests/s");
+  std::cerr << "segment-store-bench: " << num_frames << " frames of " << frame_size << " bytes, "
+            << num_interests << " segment Interests" << std::endl;
+  std::cerr << row_format % "before" % before_store_ms % before_serve_ms %
+                   (num_interests / before_serve_ms * 1000.0)
+            << std::endl;
+  std::cerr << row_format % "after" % after_store_ms % after_serve_ms %
+                   (num_interests / after_serve_ms * 1000.0)
+            << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -38,3 +38,28 @@ std::string Encoder::encode(const std::string &location_str, const std::string &
                                                {"session_id", session_id_str}};
   return json_obj.dump();
 }
+
+std::string Encoder::encode(const std::string &location_str, const std::string &time_str,
+                            const std::vector<std::string> &target_list,
+                            const std::vector<bool> &found_list,
+                            const std::string session_id_str, int64_t age_ms)
+{
+  std::string result;
+  for(size_t i = 0; i < target_list.size() && i < found_list.size(); ++i) {
+    if(i > 0) {
+      result += '\n';
+    }
+    if(age_ms < 0) {
+      result += encode(location_str, time_str, target_list[i], found_list[i], session_id_str);
+      continue;
+    }
+    json11::Json json_obj = json11::Json::object{{"isFound", static_cast<bool>(found_list[i])},
+                                                 {"target", target_list[i]},
+                                                 {"location", location_str},
+                                                 {"time", time_str},
+                                                 {"session_id", session_id_str},
+                                                 {"age_ms", static_cast<double>(age_ms)}};
+    result += json_obj.dump();
+  }
+  return result;
+}
@@ -27,7 +27,9 @@
 #ifndef ENCODE_HPP_INC
 #define ENCODE_HPP_INC
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 class Encoder {
  public:
@@ -35,6 +37,13 @@ class Encoder {
   static std::string encode(const std::string &location_str, const std::string &time_str,
                             const std::string &target_str, bool is_found,
                             const std::string session_id_str);
+  // One line per target, in the same format as above, separated by '\n'.
+  // A non-negative age_ms, the age of the detection result in milliseconds,
+  // is added to every line.
+  static std::string encode(const std::string &location_str, const std::string &time_str,
+                            const std::vector<std::string> &target_list,
+                            const std::vector<bool> &found_list,
+                            const std::string session_id_str, int64_t age_ms = -1);
 };
 
 #endif
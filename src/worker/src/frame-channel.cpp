@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#include "frame-channel.hpp"
+
+#include <atomic>
+
+FrameChannel::FrameChannel() : m_pool(), m_back(), m_latest(), m_sequence(0) {}
+
+cv::Mat &FrameChannel::acquire()
+{
+  if(!m_back) {
+    // A buffer referenced only by the pool is neither the latest frame nor
+    // held by a reader. Readers can only gain a reference to the latest one.
+    for(const auto &buffer : m_pool) {
+      if(buffer.use_count() == 1) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        m_back = buffer;
+        break;
+      }
+    }
+    if(!m_back) {
+      m_back = std::make_shared<CapturedFrame>();
+      m_pool.push_back(m_back);
+    }
+  }
+  return m_back->image;
+}
+
+void FrameChannel::publish(uint64_t timestamp)
+{
+  if(!m_back) {
+    return;
+  }
+  m_back->sequence = ++m_sequence;
+  m_back->timestamp = timestamp;
+  std::atomic_store(&m_latest, frame_ptr(std::move(m_back)));
+  m_back.reset();
+}
+
+frame_ptr FrameChannel::latest() const
+{
+  return std::atomic_load(&m_latest);
+}
@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#ifndef FRAME_CHANNEL_HPP_INC
+#define FRAME_CHANNEL_HPP_INC
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+struct CapturedFrame {
+  cv::Mat image;
+  uint64_t sequence = 0;   // 1 for the first captured frame
+  uint64_t timestamp = 0;  // capture time, milliseconds since the epoch
+};
+
+using frame_ptr = std::shared_ptr<const CapturedFrame>;
+
+// Hands the newest captured frame from one writer to any number of readers.
+//
+// The writer fills a buffer from acquire() and makes it the latest frame
+// with publish(). Readers get a reference-counted pointer from latest() and
+// may keep it as long as they like; the image is never copied. A buffer is
+// reused by acquire() only once no reader references it any more, so a
+// reader never sees its frame change, and the image allocation is recycled
+// when the frame size stays the same. The latest pointer is swapped
+// atomically; the writer and readers share no mutex.
+class FrameChannel {
+ public:
+  FrameChannel();
+  ~FrameChannel() = default;
+  FrameChannel(const FrameChannel &) = delete;
+  FrameChannel &operator=(const FrameChannel &) = delete;
+
+  // Writer side; called from a single thread.
+  cv::Mat &acquire();
+  void publish(uint64_t timestamp);
+
+  // Reader side; nullptr until the first frame is published.
+  frame_ptr latest() const;
+
+ private:
+  std::vector<std::shared_ptr<CapturedFrame>> m_pool;
+  std::shared_ptr<CapturedFrame> m_back;
+  frame_ptr m_latest;  // accessed with std::atomic_load / std::atomic_store only
+  uint64_t m_sequence;
+};
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#ifndef FRAME_CODEC_HPP_INC
+#define FRAME_CODEC_HPP_INC
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// Codec of the frames transferred from workers to the edge in cloud mode.
+// The edge asks for a codec in the name of the first Interest, see
+// FrameCodec::request_key(); the worker falls back to raw when the requested
+// one is unavailable.
+struct FrameRequest {
+  uint8_t codec = 0;    // FrameCodec::Type
+  uint8_t quality = 0;  // 0-100; for PNG the compression level is quality / 10
+  // Size the worker letterboxes frames to before encoding them, usually the
+  // network input size of the edge; 0 keeps the camera resolution.
+  uint16_t width = 0;
+  uint16_t height = 0;
+};
+
+// Header put in front of every cloud-mode frame, so that the edge can wrap the
+// reassembled buffer as a cv::Mat without copying and without assuming a
+// camera resolution. All fields are big-endian.
+//
+//   0  version      uint8
+//   1  codec        uint8   FrameCodec::Type
+//   2  reserved     uint16
+//   4  rows         uint32
+//   8  cols         uint32
+//  12  type         uint32  OpenCV type of the decoded frame, e.g. CV_8UC3
+//  16  timestamp    uint64  capture time in milliseconds since the UNIX epoch
+//  24  source_rows  uint32  size of the camera frame in a letterboxed frame
+//  28  source_cols  uint32
+//  32  scale        float32 camera to transferred frame, as IEEE 754 bits
+//  36  pad_x        uint16  offset of the scaled camera frame
+//  38  pad_y        uint16
+//
+// Headers of any other version are rejected.
+struct FrameHeader {
+  static constexpr size_t size = 40;
+  static constexpr uint8_t version = 2;
+
+  uint8_t codec = 0;
+  uint32_t rows = 0;
+  uint32_t cols = 0;
+  uint32_t type = 0;
+  uint64_t timestamp = 0;
+  uint32_t source_rows = 0;
+  uint32_t source_cols = 0;
+  float scale = 1.0f;
+  uint16_t pad_x = 0;
+  uint16_t pad_y = 0;
+
+  // Both take size bytes; the frame follows them.
+  void encode(uint8_t *data) const;
+  bool decode(const uint8_t *data, size_t length);
+  // Maps a box in the transferred frame back to the camera frame.
+  cv::Rect to_source(const cv::Rect &box) const;
+};
+
+class FrameCodec {
+ public:
+  enum Type : uint8_t { RAW = 0, JPEG = 1, PNG = 2, WEBP = 3 };
+
+  FrameCodec() = delete;
+
+  // Encodes frame and appends it to buffer. Returns the codec actually used.
+  static uint8_t encode(const cv::Mat &frame, const FrameRequest &request,
+                        std::vector<uint8_t> &buffer);
+  // Decodes a compressed frame. Returns an empty Mat for raw or broken input.
+  static cv::Mat decode(const uint8_t *data, size_t length);
+  // Scales frame down to fit size, keeping its aspect ratio, and centres it
+  // on a grey canvas of size. Records the scale and the padding in header.
+  // Frames that already fit are returned as they are.
+  static cv::Mat letterbox(const cv::Mat &frame, const cv::Size &size, FrameHeader &header);
+
+  static bool from_string(const std::string &str, uint8_t &codec);
+  static const char *to_string(uint8_t codec);
+
+  // Name component the edge requests frames with, e.g. "#c:jpeg,90" or,
+  // with a letterbox size, "#c:jpeg,90,416x416". It is
+  // put in the name rather than in the Interest parameters, because
+  // SegmentFetcher copies the parameters, and with them a parameters digest,
+  // into every segment Interest, which the segments named by the worker
+  // would then not satisfy.
+  static std::string request_key(const FrameRequest &request);
+  static bool parse_request_key(const std::string &key, FrameRequest &request);
+};
+
+#endif
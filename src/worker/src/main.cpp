@@ -34,18 +34,43 @@
 int main(int argc, char **argv)
 {
   Parameter::instance().parse(argc, argv);
+  std::cerr << Parameter::instance();
 
   try {
+    DetectorConfig detector_config;
+    detector_config.model = Parameter::instance().model();
+    detector_config.config = Parameter::instance().model_config();
+    detector_config.classes = Parameter::instance().classes_file();
+    detector_config.backend = Parameter::instance().backend();
+    detector_config.precision = Parameter::instance().precision();
+    detector_config.input_width = Parameter::instance().input_size();
+    detector_config.input_height = Parameter::instance().input_size();
+    detector_config.annotate = Parameter::instance().is_annotate_mode();
+    detector_config.snapshot_dir = Parameter::instance().snapshot_dir();
+    detector_config.snapshot_rate = Parameter::instance().snapshot_rate();
+    detector_config.change_threshold = Parameter::instance().change_threshold();
+    detector_config.inference_rate = Parameter::instance().inference_rate();
+    detector_config.tile_columns = Parameter::instance().tile_columns();
+    detector_config.tile_rows = Parameter::instance().tile_rows();
+    detector_config.tile_overlap = Parameter::instance().tile_overlap();
+
     detector_ptr detector;
     if(Parameter::instance().is_emulation_mode()) {
       detector = detector_ptr(new EmulateObjectDetection());
     } else {
-      detector = detector_ptr(new DnnObjectDetection(Parameter::instance().dummy_file()));
+      detector = detector_ptr(
+          new DnnObjectDetection(detector_config, Parameter::instance().dummy_file()));
     }
-    Worker worker(Parameter::instance().cd(), detector);
+    Worker::Options options;
+    options.maxSegmentSize = Parameter::instance().segment_size();
+    options.storeLimits.max_versions = Parameter::instance().store_versions();
+    options.storeLimits.max_bytes = Parameter::instance().store_bytes();
+    options.storeLimits.max_age = std::chrono::milliseconds(Parameter::instance().store_age());
+    Worker worker(Parameter::instance().cd(), options, detector);
     worker.run();
   } catch(std::exception &e) {
-    std::cerr << e.what() << std::endl;
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
   }
 
   return 0;
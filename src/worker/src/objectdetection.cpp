@@ -25,69 +25,212 @@
  *
  */
 #include "objectdetection.hpp"
+#include "yolo-postprocess.hpp"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <ctime>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <random>
+#include <sstream>
+#include <stdexcept>
 
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/videoio.hpp>
 
-EmulateObjectDetection::EmulateObjectDetection() : ObjectDetection(), m_classes(0)
+namespace {
+uint64_t unixTimeMillis()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+bool ObjectDetection::contains(const std::vector<Detection>& detections,
+                               const std::string& class_name) const
+{
+  const std::vector<std::string>& names = classNames();
+  return std::any_of(detections.begin(), detections.end(), [&](const Detection& detection) {
+    return names[detection.class_id] == class_name;
+  });
+}
+
+SceneChangeGate::SceneChangeGate(int threshold, size_t capacity)
+    : m_threshold(threshold), m_capacity(std::max<size_t>(capacity, 1)), m_hits(0), m_misses(0)
+{}
+
+bool SceneChangeGate::lookup(const cv::Mat& frame, Signature& signature,
+                             std::vector<Detection>& result)
+{
+  if(!isEnabled() || frame.empty()) {
+    return false;
+  }
+
+  // Shrink first, so the colour conversion touches 1024 pixels only.
+  cv::Mat small;
+  cv::resize(frame, small, cv::Size(32, 32), 0, 0, cv::INTER_AREA);
+  if(small.channels() == 3) {
+    cv::cvtColor(small, signature.thumbnail, cv::COLOR_BGR2GRAY);
+  } else if(small.channels() == 4) {
+    cv::cvtColor(small, signature.thumbnail, cv::COLOR_BGRA2GRAY);
+  } else {
+    signature.thumbnail = small;
+  }
+  signature.frame_size = frame.size();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for(auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if(it->signature.frame_size == signature.frame_size &&
+       it->signature.thumbnail.type() == signature.thumbnail.type() &&
+       cv::norm(it->signature.thumbnail, signature.thumbnail, cv::NORM_INF) <= m_threshold) {
+      ++m_hits;
+      result.insert(result.end(), it->detections.begin(), it->detections.end());
+      // Keep the scenes that are still being looked at.
+      std::rotate(m_entries.begin(), it, it + 1);
+      return true;
+    }
+  }
+  ++m_misses;
+  return false;
+}
+
+void SceneChangeGate::update(Signature&& signature, const std::vector<Detection>& detections)
+{
+  if(!isEnabled() || signature.thumbnail.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.push_front(Entry{std::move(signature), detections});
+  if(m_entries.size() > m_capacity) {
+    m_entries.pop_back();
+  }
+}
+
+EmulateObjectDetection::EmulateObjectDetection() : ObjectDetection(), m_classes(0), m_candidates(0)
 {
   const std::string classesFile = "./config/coco.names";
   std::ifstream ifs(classesFile.c_str());
 
   std::string line;
   while(std::getline(ifs, line)) {
-    if(line.compare("person") != 0) m_classes.push_back(line);
+    if(line.compare("person") != 0) m_candidates.push_back(static_cast<int>(m_classes.size()));
+    m_classes.push_back(line);
   }
 }
 
-cv::Mat EmulateObjectDetection::returnMat()
+frame_ptr EmulateObjectDetection::latestFrame()
 {
-  cv::Mat m = (cv::Mat::zeros(5, 5, CV_8U));
-  return m;
+  auto frame = std::make_shared<CapturedFrame>();
+  frame->image = cv::Mat::zeros(5, 5, CV_8U);
+  return frame;
 }
 
-void EmulateObjectDetection::detect(std::vector<std::string>& result)
+detection_set_ptr EmulateObjectDetection::detect()
 {
   std::random_device rand_dev;
   std::mt19937 engine(rand_dev());
 
-  std::shuffle(m_classes.begin(), m_classes.end(), engine);
-  std::copy_n(m_classes.begin(), 10, std::back_inserter(result));
+  auto result = std::make_shared<DetectionSet>();
+  result->sequence = 0;
+  result->timestamp = unixTimeMillis();
+  std::shuffle(m_candidates.begin(), m_candidates.end(), engine);
+  for(size_t i = 0; i < 10 && i < m_candidates.size(); ++i) {
+    result->detections.push_back(Detection{m_candidates[i], 1.0f, cv::Rect()});
+  }
 
-  return;
+  return result;
+}
+
+namespace {
+// Splits a frame of frame_size into a grid of columns x rows tiles that
+// overlap their neighbours by overlap of their size. The outer tiles are
+// aligned with the frame borders.
+std::vector<cv::Rect> tileRects(const cv::Size& frame_size, int columns, int rows, double overlap)
+{
+  const auto place = [overlap](int length, int count, std::vector<std::pair<int, int>>& spans) {
+    const int span = std::min(
+        length, static_cast<int>(std::ceil(static_cast<double>(length) / count * (1.0 + overlap))));
+    for(int i = 0; i < count; ++i) {
+      const int start = (count > 1) ? static_cast<int>(std::lround(
+                                          static_cast<double>(length - span) * i / (count - 1)))
+                                    : 0;
+      spans.emplace_back(start, span);
+    }
+  };
+  std::vector<std::pair<int, int>> xs, ys;
+  place(frame_size.width, columns, xs);
+  place(frame_size.height, rows, ys);
+
+  std::vector<cv::Rect> tiles;
+  tiles.reserve(xs.size() * ys.size());
+  for(const auto& y : ys) {
+    for(const auto& x : xs) {
+      tiles.emplace_back(x.first, y.first, x.second, y.second);
+    }
+  }
+  return tiles;
 }
 
-DnnObjectDetection::DnnObjectDetection(const std::string& dummy_file)
+// Loads the network of config on its backend and target, falling back to
+// the OpenCV backend on the CPU when the requested pair is unavailable.
+cv::dnn::Net loadNet(const DetectorConfig& config)
+{
+  cv::dnn::Net net = cv::dnn::readNet(config.model, config.config);
+
+  const cv::dnn::Backend backend = (config.backend == "inference-engine")
+                                       ? cv::dnn::DNN_BACKEND_INFERENCE_ENGINE
+                                       : cv::dnn::DNN_BACKEND_OPENCV;
+  // The OpenCV CPU path has no half precision; FP16 runs through OpenCL,
+  // which itself falls back to the CPU when no device is present.
+  const cv::dnn::Target target =
+      (config.precision == "fp16") ? cv::dnn::DNN_TARGET_OPENCL_FP16 : cv::dnn::DNN_TARGET_CPU;
+
+  const auto available = cv::dnn::getAvailableBackends();
+  if(std::find(available.begin(), available.end(), std::make_pair(backend, target)) !=
+     available.end()) {
+    net.setPreferableBackend(backend);
+    net.setPreferableTarget(target);
+  } else {
+    std::cerr << "[WARN] DNN backend " << config.backend << " with " << config.precision
+              << " is not available, using opencv with fp32" << std::endl;
+    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+  }
+  return net;
+}
+}  // namespace
+
+DnnObjectDetection::DnnObjectDetection(const DetectorConfig& config, const std::string& dummy_file)
     : ObjectDetection(),
+      inpWidth(config.input_width),
+      inpHeight(config.input_height),
+      m_config(config),
       m_dummy_file(dummy_file),
       m_is_dummy_mode(!dummy_file.empty()),
-      m_is_verbose(false)
+      m_is_verbose(config.annotate),
+      m_snapshot_writer(config.snapshot_dir, config.snapshot_rate),
+      m_result_hits(0),
+      m_result_misses(0),
+      m_scene_gate(config.change_threshold, 1),
+      m_run(false),
+      m_inference_period(config.inference_rate > 0.0
+                             ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                   std::chrono::duration<double>(1.0 / config.inference_rate))
+                             : std::chrono::steady_clock::duration::zero()),
+      m_ready(false)
 {
   // Load names of classes
-  const std::string classesFile = "./config/coco.names";
-  // Give the configuration and weight files for the model
-  const cv::String modelConfiguration = "./config/yolov3.cfg";
-  const cv::String modelWeights = "./config/yolov3.weights";
-
-  std::ifstream ifs(classesFile.c_str());
+  std::ifstream ifs(config.classes.c_str());
 
   std::string line;
   while(std::getline(ifs, line)) m_classes.push_back(line);
 
-  // Load the network
-  m_net = cv::dnn::readNetFromDarknet(modelConfiguration, modelWeights);
-  m_net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-  m_net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
-
   if(m_is_dummy_mode == false) {  // ダミーを使う
     int device_id = 0;
     int api_id = cv::CAP_ANY;
@@ -100,12 +243,69 @@ DnnObjectDetection::DnnObjectDetection(const std::string& dummy_file)
 
   m_run = true;
   m_thread = std::thread([this]() { this->capture(); });
+
+  // Load the network in the background, so that the face can come up and
+  // answer Interests while the weights are parsed.
+  m_loader = std::thread([this]() { this->load(); });
+
+  if(m_inference_period.count() > 0) {
+    m_inference = std::thread([this]() { this->infer(); });
+  }
 }
 DnnObjectDetection::~DnnObjectDetection()
 {
+  if(m_loader.joinable()) {
+    m_loader.join();
+  }
   if(m_run == true) {
     m_run = false;
     m_thread.join();
+    if(m_inference.joinable()) {
+      m_inference.join();
+    }
+  }
+}
+
+void DnnObjectDetection::load()
+{
+  try {
+    const auto load_start = std::chrono::steady_clock::now();
+    m_net = loadNet(m_config);
+    const double load_ms = std::chrono::duration<double, std::milli>(
+                               std::chrono::steady_clock::now() - load_start)
+                               .count();
+    // The measured pass comes after a warm-up pass, so the first real frame
+    // does not pay for the layer allocation.
+    const double latency_ms = measureLatency();
+    std::cerr << "[INFO] Loaded model " << m_config.model << " (" << m_config.input_width << "x"
+              << m_config.input_height << ", " << m_config.backend << ", " << m_config.precision
+              << ") in " << load_ms << " ms: " << latency_ms << " ms per frame" << std::endl;
+  } catch(const std::exception& e) {
+    // The thread that waits for the model reports it.
+    std::lock_guard<std::mutex> lock(m_ready_mutex);
+    m_load_error = std::string("cannot load model ") + m_config.model + ": " + e.what();
+    m_ready_cond.notify_all();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_ready_mutex);
+    m_ready.store(true, std::memory_order_release);
+  }
+  m_ready_cond.notify_all();
+}
+
+void DnnObjectDetection::waitReady()
+{
+  if(m_ready.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(m_ready_mutex);
+  m_ready_cond.wait(lock, [this] {
+    return m_ready.load(std::memory_order_acquire) || !m_load_error.empty();
+  });
+  if(!m_load_error.empty()) {
+    throw std::runtime_error(m_load_error);
   }
 }
 
@@ -113,15 +313,13 @@ void DnnObjectDetection::capture()
 {
   while(m_run) {
     if(m_is_dummy_mode == true) {
-      {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_frame = cv::imread(m_dummy_file);
-      }
+      m_frames.acquire() = cv::imread(m_dummy_file);
+      m_frames.publish(unixTimeMillis());
       std::this_thread::sleep_for(std::chrono::milliseconds(5000));
     } else {
-      if(m_camera.grab()) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_camera.retrieve(m_frame);
+      // retrieve() reuses the buffer's allocation when the size is unchanged.
+      if(m_camera.grab() && m_camera.retrieve(m_frames.acquire())) {
+        m_frames.publish(unixTimeMillis());
       }
       std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
@@ -129,48 +327,103 @@ void DnnObjectDetection::capture()
   return;
 }
 
-cv::Mat DnnObjectDetection::returnMat()
+frame_ptr DnnObjectDetection::latestFrame()
 {
-  std::string str;
-  const std::string outputFile("camera.jpg");
-  cv::Mat frame;
+  frame_ptr frame = m_frames.latest();
+  if(frame) {
+    // The frame keeps its buffer from being recycled until it is written.
+    m_snapshot_writer.submit("camera.jpg", frame->image, frame);
+  }
+  return frame;
+}
 
-  {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    frame = m_frame.clone();
+detection_set_ptr DnnObjectDetection::detect()
+{
+  if(m_inference_period.count() > 0) {
+    return std::atomic_load(&m_result);
   }
+  waitReady();
+  return update();
+}
 
-  // std::cout << frame.rows << "\n "<< frame.cols << "\n " << frame.dims   << std::endl;
-  cv::imwrite("camera.jpg", frame);
-  return frame;
+// Runs update() at the configured rate, so that detect() never waits for a
+// forward pass. Periods missed by a slow pass are skipped, not caught up.
+void DnnObjectDetection::infer()
+{
+  try {
+    waitReady();
+  } catch(const std::exception&) {
+    return;  // Worker::run() reports it
+  }
+  auto next = std::chrono::steady_clock::now();
+  while(m_run) {
+    update();
+    next = std::max(next + m_inference_period, std::chrono::steady_clock::now());
+    std::this_thread::sleep_until(next);
+  }
 }
 
-void DnnObjectDetection::detect(std::vector<std::string>& result)
+// Detects objects in the latest frame unless that has already been done,
+// and returns the detections of the latest frame.
+detection_set_ptr DnnObjectDetection::update()
 {
-  std::string str;
-  const std::string outputFile("camera.jpg");
-  cv::Mat blob, frame;
+  cv::Mat blob;
 
-  {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    frame = m_frame.clone();
+  std::lock_guard<std::mutex> result_lock(m_result_mutex);
+  const frame_ptr captured = m_frames.latest();
+  if(!captured) {
+    return m_result;
+  }
+  const uint64_t sequence = captured->sequence;
+  if(m_result && sequence == m_result->sequence) {
+    ++m_result_hits;
+    return m_result;
   }
+  cv::Mat frame = captured->image;
+  ++m_result_misses;
 
-  // Create a 4D blob from a frame.
-  cv::dnn::blobFromImage(frame, blob, 1 / 255.0, cvSize(inpWidth, inpHeight), cv::Scalar(0, 0, 0),
-                         true, false);
+  auto detected = std::make_shared<DetectionSet>();
+  detected->sequence = sequence;
+  detected->timestamp = captured->timestamp;
 
-  // Sets the input to the network
-  m_net.setInput(blob);
+  SceneChangeGate::Signature signature;
+  if(m_scene_gate.lookup(frame, signature, detected->detections)) {
+    std::atomic_store(&m_result, detection_set_ptr(detected));
+    return detected;
+  }
+  const auto detect_start = std::chrono::steady_clock::now();
 
-  // Runs the forward pass to get output of the output layers
-  std::vector<cv::Mat> outs;
-  m_net.forward(outs, getOutputsNames());
+  if(m_config.tile_columns * m_config.tile_rows > 1) {
+    detectTiled(frame, detected->detections);
+  } else {
+    // Create a 4D blob from a frame.
+    cv::dnn::blobFromImage(frame, blob, 1 / 255.0, cvSize(inpWidth, inpHeight),
+                           cv::Scalar(0, 0, 0), true, false);
+
+    // Sets the input to the network
+    m_net.setInput(blob);
 
-  // Remove the bounding boxes with low confidence
-  postprocess(frame, outs, result);
+    // Runs the forward pass to get output of the output layers
+    std::vector<cv::Mat> outs;
+    m_net.forward(outs, getOutputsNames());
 
-  if(m_is_verbose) {
+    // Remove the bounding boxes with low confidence
+    postprocess(frame.size(), outs, detected->detections);
+  }
+  m_scene_gate.update(std::move(signature), detected->detections);
+  std::atomic_store(&m_result, detection_set_ptr(detected));
+
+  const double detect_ms = std::chrono::duration<double, std::milli>(
+                               std::chrono::steady_clock::now() - detect_start)
+                               .count();
+  std::cerr << "[INFO] Detected " << detected->detections.size() << " objects in frame " << sequence << " in "
+            << detect_ms << " ms (" << m_result_hits << " cached results so far, "
+            << m_scene_gate.hits() << " of " << m_result_misses
+            << " new frames passed as unchanged)" << std::endl;
+
+  if(m_is_verbose && m_snapshot_writer.isDue()) {
+    frame = frame.clone();
+    annotate(frame, detected->detections);
     // Put efficiency information. The function getPerfProfile returns the overall time for
     // inference(t) and the timings for each of the layers(in layersTimes)
     std::vector<double> layersTimes;
@@ -183,56 +436,143 @@ void DnnObjectDetection::detect(std::vector<std::string>& result)
     // Write the frame with the detection boxes
     cv::Mat detectedFrame;
     frame.convertTo(detectedFrame, CV_8U);
-    cv::imwrite("camera.jpg", detectedFrame);
+    m_snapshot_writer.submit("camera.jpg", detectedFrame);
   }
 
-  return;
+  return detected;
 }
 
-// Remove the bounding boxes with low confidence using non-maxima suppression
-void DnnObjectDetection::postprocess(cv::Mat& frame, const std::vector<cv::Mat>& outs,
-                                     std::vector<std::string>& result)
+// Detects objects in overlapping tiles of frame and in the whole frame,
+// which all go through the network as one batch. Small objects that the
+// downscaling of the whole frame would erase are found in the tiles;
+// objects larger than a tile are found in the whole frame.
+void DnnObjectDetection::detectTiled(const cv::Mat& frame, std::vector<Detection>& result)
 {
-  std::vector<int> classIds;
-  std::vector<float> confidences;
-  std::vector<cv::Rect> boxes;
+  const auto detect_start = std::chrono::steady_clock::now();
 
-  for(size_t i = 0; i < outs.size(); ++i) {
-    // Scan through all the bounding boxes output from the network and keep only the
-    // ones with high confidence scores. Assign the box's class label as the class
-    // with the highest score for the box.
-    float* data = (float*) outs[i].data;
-    for(int j = 0; j < outs[i].rows; ++j, data += outs[i].cols) {
-      cv::Mat scores = outs[i].row(j).colRange(5, outs[i].cols);
-      cv::Point classIdPoint;
-      double confidence;
-      // Get the value and location of the maximum score
-      minMaxLoc(scores, 0, &confidence, 0, &classIdPoint);
-      if(confidence > confThreshold) {
-        int centerX = (int) (data[0] * frame.cols);
-        int centerY = (int) (data[1] * frame.rows);
-        int width = (int) (data[2] * frame.cols);
-        int height = (int) (data[3] * frame.rows);
-        int left = centerX - width / 2;
-        int top = centerY - height / 2;
-
-        classIds.push_back(classIdPoint.x);
-        confidences.push_back((float) confidence);
-        boxes.push_back(cv::Rect(left, top, width, height));
+  std::vector<cv::Rect> tiles = tileRects(frame.size(), m_config.tile_columns, m_config.tile_rows,
+                                          m_config.tile_overlap);
+  tiles.emplace_back(cv::Point(0, 0), frame.size());
+
+  // The tiles are views into frame; blobFromImages() resizes them directly.
+  std::vector<cv::Mat> images;
+  images.reserve(tiles.size());
+  for(const cv::Rect& tile : tiles) {
+    images.push_back(frame(tile));
+  }
+  cv::Mat blob;
+  cv::dnn::blobFromImages(images, blob, 1 / 255.0, cv::Size(inpWidth, inpHeight),
+                          cv::Scalar(0, 0, 0), true, false);
+  m_net.setInput(blob);
+  std::vector<cv::Mat> outs;
+  m_net.forward(outs, getOutputsNames());
+  const double forward_ms = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - detect_start)
+                                .count();
+
+  // Each output layer stacks the rows of all tiles, either as a 2D
+  // [N * rows, cols] or as a 3D [N, rows, cols] matrix depending on the
+  // OpenCV version.
+  const int num_tiles = static_cast<int>(tiles.size());
+  for(auto& out : outs) {
+    if(out.dims == 3) {
+      out = out.reshape(1, out.size[0] * out.size[1]);
+    }
+  }
+
+  YoloPostprocess::Candidates candidates;
+  std::ostringstream tile_ms;
+  for(int n = 0; n < num_tiles; ++n) {
+    const auto tile_start = std::chrono::steady_clock::now();
+    const cv::Rect& tile = tiles[n];
+
+    YoloPostprocess::Candidates tile_candidates;
+    for(const auto& out : outs) {
+      const int rows = out.rows / num_tiles;
+      YoloPostprocess::scan(out.rowRange(n * rows, (n + 1) * rows), confThreshold, tile.size(),
+                            tile_candidates);
+    }
+
+    // A box cut off by an inner tile border is a fragment of an object that
+    // the overlapping neighbour or the whole frame sees in full. Keep only
+    // boxes clear of inner borders, moved to frame coordinates.
+    const int margin = 2;
+    const bool inner_left = tile.x > 0;
+    const bool inner_top = tile.y > 0;
+    const bool inner_right = tile.br().x < frame.cols;
+    const bool inner_bottom = tile.br().y < frame.rows;
+    for(size_t i = 0; i < tile_candidates.boxes.size(); ++i) {
+      const cv::Rect& box = tile_candidates.boxes[i];
+      if((inner_left && box.x <= margin) || (inner_top && box.y <= margin) ||
+         (inner_right && box.br().x >= tile.width - margin) ||
+         (inner_bottom && box.br().y >= tile.height - margin)) {
+        continue;
       }
+      candidates.class_ids.push_back(tile_candidates.class_ids[i]);
+      candidates.confidences.push_back(tile_candidates.confidences[i]);
+      candidates.boxes.push_back(box + tile.tl());
     }
+
+    tile_ms << (n > 0 ? ", " : "")
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                         tile_start)
+                   .count();
   }
 
-  // Perform non maximum suppression to eliminate redundant overlapping boxes with
-  // lower confidences
+  // Objects in the overlaps are found by several tiles; suppression across
+  // all tiles keeps the best box of each.
   std::vector<int> indices;
-  cv::dnn::NMSBoxes(boxes, confidences, confThreshold, nmsThreshold, indices);
+  YoloPostprocess::suppress(candidates, confThreshold, nmsThreshold, indices);
+  result.reserve(result.size() + indices.size());
+  for(int idx : indices) {
+    result.push_back(
+        Detection{candidates.class_ids[idx], candidates.confidences[idx], candidates.boxes[idx]});
+  }
+
+  const double total_ms = std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - detect_start)
+                              .count();
+  // The tiles go through the network as one batch, so only the batch has a
+  // latency of its own; the per-image figure is an average.
+  std::cerr << "[INFO] Tiled detection of " << m_config.tile_columns << "x" << m_config.tile_rows
+            << " tiles and the whole frame: blob and forward pass of the batch of " << num_tiles
+            << " images " << forward_ms << " ms (average " << forward_ms / num_tiles
+            << " ms per image), postprocess per tile [" << tile_ms.str() << "] ms, "
+            << candidates.boxes.size() << " candidates into " << indices.size()
+            << " objects, total " << total_ms << " ms" << std::endl;
+}
+
+// Remove the bounding boxes with low confidence using non-maxima suppression
+void DnnObjectDetection::postprocess(const cv::Size& frame_size, const std::vector<cv::Mat>& outs,
+                                     std::vector<Detection>& result)
+{
+  YoloPostprocess::Candidates candidates;
+  for(size_t i = 0; i < outs.size(); ++i) {
+    YoloPostprocess::scan(outs[i], confThreshold, frame_size, candidates);
+  }
+  const std::vector<int>& classIds = candidates.class_ids;
+  const std::vector<float>& confidences = candidates.confidences;
+  const std::vector<cv::Rect>& boxes = candidates.boxes;
+
+  // Perform non maximum suppression per class to eliminate redundant
+  // overlapping boxes with lower confidences
+  std::vector<int> indices;
+  YoloPostprocess::suppress(candidates, confThreshold, nmsThreshold, indices);
+
+  result.reserve(result.size() + indices.size());
   for(size_t i = 0; i < indices.size(); ++i) {
     int idx = indices[i];
-    cv::Rect box = boxes[idx];
-    result.push_back(m_classes[classIds[idx]]);
-    drawPred(classIds[idx], confidences[idx], box.x, box.y, box.x + box.width, box.y + box.height,
-             frame);
+    result.push_back(Detection{classIds[idx], confidences[idx], boxes[idx]});
+  }
+}
+
+// Draw the detections into frame; only done when annotation is enabled
+void DnnObjectDetection::annotate(cv::Mat& frame, const std::vector<Detection>& detections)
+{
+  for(const Detection& detection : detections) {
+    const cv::Rect& box = detection.box;
+    drawPred(detection.class_id, detection.confidence, box.x, box.y, box.x + box.width,
+             box.y + box.height, frame);
   }
 }
 
@@ -250,9 +590,6 @@ void DnnObjectDetection::drawPred(int classId, float conf, int left, int top, in
     label = m_classes[classId] + ":" + label;
   }
 
-  std::cout << m_classes[classId] << "," << top << "," << left << "," << right << "," << bottom
-            << std::endl;
-
   // Display the label at the top of the bounding box
   int baseLine;
   cv::Size labelSize = getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
@@ -264,6 +601,27 @@ void DnnObjectDetection::drawPred(int classId, float conf, int left, int top, in
           1);
 }
 
+// Runs the network on a blank frame and returns the time of one forward pass.
+// The first pass also allocates the layers, so the second one is measured.
+double DnnObjectDetection::measureLatency()
+{
+  const cv::Mat frame(inpHeight, inpWidth, CV_8UC3, cv::Scalar(0, 0, 0));
+  cv::Mat blob;
+  cv::dnn::blobFromImage(frame, blob, 1 / 255.0, cv::Size(inpWidth, inpHeight),
+                         cv::Scalar(0, 0, 0), true, false);
+
+  std::vector<cv::Mat> outs;
+  double latency_ms = 0.0;
+  for(int i = 0; i < 2; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    m_net.setInput(blob);
+    m_net.forward(outs, getOutputsNames());
+    latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                     .count();
+  }
+  return latency_ms;
+}
+
 // Get the names of the output layers
 std::vector<cv::String> DnnObjectDetection::getOutputsNames()
 {
@@ -27,8 +27,14 @@
 #ifndef OBJECTDETECTION_HPP_INC
 #define OBJECTDETECTION_HPP_INC
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <exception>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -37,8 +43,99 @@
 #include <opencv2/dnn.hpp>
 #include <opencv2/videoio.hpp>
 
+#include "frame-channel.hpp"
+#include "snapshot-writer.hpp"
+
 using detector_ptr = std::shared_ptr<class ObjectDetection>;
 
+// Model and inference settings of DnnObjectDetection. model and config are
+// passed to cv::dnn::readNet(), which picks the framework (Darknet, ONNX,
+// ...) from the file extensions. The outputs are postprocessed as YOLO
+// region layers, so the model has to be a YOLO variant.
+struct DetectorConfig {
+  std::string model = "./config/yolov3.weights";
+  std::string config = "./config/yolov3.cfg";
+  std::string classes = "./config/coco.names";
+  std::string backend = "opencv";  // opencv | inference-engine
+  std::string precision = "fp32";  // fp32 | fp16
+  int input_width = 416;
+  int input_height = 416;
+  bool annotate = false;  // draw the detections into the snapshots
+  std::string snapshot_dir = ".";
+  double snapshot_rate = 1.0;  // snapshots per second; 0 disables them
+  int change_threshold = 8;    // see SceneChangeGate; 0 disables the gate
+  double inference_rate = 0.0;  // detections per second run in the background;
+                                // 0 detects on demand
+  // Grid of overlapping tiles the frame is detected in, in addition to the
+  // whole frame; 1x1 detects on the whole frame only.
+  int tile_columns = 1;
+  int tile_rows = 1;
+  double tile_overlap = 0.2;  // fraction of a tile shared with its neighbours
+};
+
+// One detected object. class_id indexes ObjectDetection::classNames().
+struct Detection {
+  int class_id;
+  float confidence;
+  cv::Rect box;
+};
+
+// Detections of one captured frame. timestamp is the capture time of the
+// frame in milliseconds since the Unix epoch.
+struct DetectionSet {
+  uint64_t sequence;
+  uint64_t timestamp;
+  std::vector<Detection> detections;
+};
+
+using detection_set_ptr = std::shared_ptr<const DetectionSet>;
+
+// Recognizes frames that look the same as a recently detected one, so that
+// its detections can be reused instead of running the network again.
+//
+// A frame is reduced to a 32x32 grey thumbnail, and it is unchanged when no
+// thumbnail cell differs from a remembered one by more than threshold grey
+// levels. Comparing cells rather than a global hash keeps a person entering
+// a small part of the view from going unnoticed. Only detected frames are
+// remembered, so slow drift is caught once it adds up to the threshold. A
+// threshold of 0 disables the gate.
+class SceneChangeGate {
+ public:
+  struct Signature {
+    cv::Size frame_size;
+    cv::Mat thumbnail;
+  };
+
+  SceneChangeGate(int threshold, size_t capacity);
+
+  bool isEnabled() const { return m_threshold > 0; }
+  // Computes the signature of frame. Returns true and appends the
+  // detections of the matching remembered frame to result if frame is
+  // unchanged.
+  bool lookup(const cv::Mat& frame, Signature& signature, std::vector<Detection>& result);
+  // Remembers the detections of the frame with signature, forgetting the
+  // least recently matched frame beyond capacity.
+  void update(Signature&& signature, const std::vector<Detection>& detections);
+
+  uint64_t hits() const { return m_hits; }
+  uint64_t misses() const { return m_misses; }
+
+ private:
+  struct Entry {
+    Signature signature;
+    std::vector<Detection> detections;
+  };
+
+  const int m_threshold;
+  const size_t m_capacity;
+
+  std::mutex m_mutex;
+  std::deque<Entry> m_entries;  // most recently matched first
+
+  std::atomic<uint64_t> m_hits;
+  std::atomic<uint64_t> m_misses;
+};
+
 class ObjectDetection {
  public:
   ObjectDetection() = default;
@@ -53,27 +150,44 @@ class ObjectDetection {
   ObjectDetection& operator=(const ObjectDetection&) = delete;
 
   // cv::Mat returnblob();
-  virtual void detect(std::vector<std::string>& result) = 0;
-  virtual cv::Mat returnMat() = 0;
+  // False while the model is still being loaded and warmed up.
+  virtual bool isReady() const { return true; }
+  // Blocks until the model is loaded. Throws std::runtime_error if it
+  // failed to load.
+  virtual void waitReady() {}
+  virtual const std::vector<std::string>& classNames() const = 0;
+  // True if an object named class_name is among detections.
+  bool contains(const std::vector<Detection>& detections, const std::string& class_name) const;
+  // Detections of a recent frame, or nullptr if none is available yet.
+  virtual detection_set_ptr detect() = 0;
+  // Newest captured frame; shared with the capture thread, do not modify.
+  virtual frame_ptr latestFrame() = 0;
 };
 
 class EmulateObjectDetection : public ObjectDetection {
  public:
   EmulateObjectDetection();
   ~EmulateObjectDetection() {}
-  void detect(std::vector<std::string>& result) override;
-  cv::Mat returnMat() override;
+  const std::vector<std::string>& classNames() const override { return m_classes; }
+  detection_set_ptr detect() override;
+  frame_ptr latestFrame() override;
 
  private:
   std::vector<std::string> m_classes;
+  std::vector<int> m_candidates;  // every class but person
 };
 
 class DnnObjectDetection : public ObjectDetection {
  public:
-  DnnObjectDetection(const std::string& dummy_file);
+  DnnObjectDetection(const DetectorConfig& config, const std::string& dummy_file);
   ~DnnObjectDetection();
-  void detect(std::vector<std::string>& result) override;
-  cv::Mat returnMat() override;
+  bool isReady() const override { return m_ready.load(std::memory_order_acquire); }
+  void waitReady() override;
+  const std::vector<std::string>& classNames() const override { return m_classes; }
+  // With a non-zero inference rate this returns the newest background
+  // result without waiting; otherwise it detects on the latest frame.
+  detection_set_ptr detect() override;
+  frame_ptr latestFrame() override;
 
   // ムーブはOK
   DnnObjectDetection(DnnObjectDetection&&) = default;
@@ -84,29 +198,58 @@ class DnnObjectDetection : public ObjectDetection {
   DnnObjectDetection& operator=(const DnnObjectDetection&) = delete;
 
  private:
-  void postprocess(cv::Mat& frame, const std::vector<cv::Mat>& out,
-                   std::vector<std::string>& result);
+  void postprocess(const cv::Size& frame_size, const std::vector<cv::Mat>& out,
+                   std::vector<Detection>& result);
+  void detectTiled(const cv::Mat& frame, std::vector<Detection>& result);
+  void annotate(cv::Mat& frame, const std::vector<Detection>& detections);
   void drawPred(int classId, float conf, int left, int top, int right, int bottom, cv::Mat& frame);
   std::vector<cv::String> getOutputsNames();
+  double measureLatency();
+  void load();
   void capture();
+  detection_set_ptr update();
+  void infer();
 
  private:
   const float confThreshold = 0.5;  // Confidence threshold
   const float nmsThreshold = 0.4;   // Non-maximum suppression threshold
-  const int inpWidth = 416;         // Width of network's input image
-  const int inpHeight = 416;        // Height of network's input image
+  const int inpWidth;               // Width of network's input image
+  const int inpHeight;              // Height of network's input image
+  const DetectorConfig m_config;
   const std::string m_dummy_file;
   const bool m_is_dummy_mode;
   const bool m_is_verbose;
 
   cv::VideoCapture m_camera;
-  cv::Mat m_frame;
+  FrameChannel m_frames;
+  SnapshotWriter m_snapshot_writer;
   cv::dnn::Net m_net;
   std::vector<std::string> m_classes;
   std::thread m_thread;
-  mutable std::mutex m_mutex;
 
-  bool m_run;
+  // Detection result of the latest detected frame, shared by all queries
+  // against that frame. It is replaced with std::atomic_store under
+  // m_result_mutex, which also serializes forward passes.
+  std::mutex m_result_mutex;
+  detection_set_ptr m_result;
+  uint64_t m_result_hits;
+  uint64_t m_result_misses;
+  // Reuses m_result for later frames of an unchanged scene.
+  SceneChangeGate m_scene_gate;
+
+  std::atomic<bool> m_run;
+
+  // Runs update() every m_inference_period when that is non-zero.
+  const std::chrono::steady_clock::duration m_inference_period;
+  std::thread m_inference;
+
+  // The network is loaded and warmed up on m_loader; detect() waits for it.
+  // m_load_error is set instead if it fails, for waitReady() to throw.
+  std::thread m_loader;
+  std::atomic<bool> m_ready;
+  std::mutex m_ready_mutex;
+  std::condition_variable m_ready_cond;
+  std::string m_load_error;
 };
 
 class CameraOpenException : public std::exception {
@@ -7,6 +7,9 @@
 #include <boost/format.hpp>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 
 Parameter &Parameter::instance() {
   static Parameter object;
@@ -20,7 +23,25 @@ Parameter::Parameter()
       m_time_name(),
       m_dummy_file(),
       m_is_dummy_mode(false),
-      m_is_emulation_mode(false)
+      m_is_emulation_mode(false),
+      m_segment_size(8000),
+      m_store_versions(8),
+      m_store_bytes(64 * 1024 * 1024),
+      m_store_age(10000),
+      m_model("./config/yolov3.weights"),
+      m_model_config("./config/yolov3.cfg"),
+      m_classes_file("./config/coco.names"),
+      m_input_size(416),
+      m_backend("opencv"),
+      m_precision("fp32"),
+      m_is_annotate_mode(false),
+      m_snapshot_dir("."),
+      m_snapshot_rate(1.0),
+      m_change_threshold(8),
+      m_inference_rate(0.0),
+      m_tile_columns(1),
+      m_tile_rows(1),
+      m_tile_overlap(0.2)
 {}
 
 void Parameter::parse(int argc, char **argv) {
@@ -39,7 +60,43 @@ void Parameter::parse(int argc, char **argv) {
          "Time name")
         ("dummy,d", boost::program_options::value<std::string>(),
          "Run in dummy mode with specified dummy file")
-        ("emulation,e", "Run in emulation mode");
+        ("emulation,e", "Run in emulation mode")
+        ("segment-size,s", boost::program_options::value<size_t>(),
+         "Maximum payload size of a segment in bytes for cloud mode transfer")
+        ("store-versions", boost::program_options::value<size_t>(),
+         "Maximum number of frame versions kept for cloud mode transfer")
+        ("store-memory", boost::program_options::value<size_t>(),
+         "Maximum size of the kept frame versions in MiB")
+        ("store-age", boost::program_options::value<size_t>(),
+         "Time in milliseconds after which a kept frame version is dropped")
+        ("model", boost::program_options::value<std::string>(),
+         "Detection model: yolov3, yolov3-tiny or the path of a Darknet/ONNX model file")
+        ("model-config", boost::program_options::value<std::string>(),
+         "Path of the model configuration file (e.g. Darknet .cfg)")
+        ("classes", boost::program_options::value<std::string>(),
+         "Path of the file listing the class names of the model")
+        ("input-size", boost::program_options::value<int>(),
+         "Width and height of the network input; a multiple of 32")
+        ("backend", boost::program_options::value<std::string>(),
+         "DNN backend: opencv or inference-engine")
+        ("precision", boost::program_options::value<std::string>(),
+         "DNN precision: fp32 or fp16")
+        ("annotate", "Draw detections into the camera.jpg snapshots (for debugging)")
+        ("snapshot-dir", boost::program_options::value<std::string>(),
+         "Directory the camera.jpg debugging snapshots are written to")
+        ("snapshot-rate", boost::program_options::value<double>(),
+         "Maximum number of snapshots written per second; 0 disables them")
+        ("change-threshold", boost::program_options::value<int>(),
+         "Grey level difference below which a frame counts as unchanged and its "
+         "previous detections are reused; 0 disables the check")
+        ("inference-rate", boost::program_options::value<double>(),
+         "Run detection continuously this many times per second and answer edge mode "
+         "queries from the latest result; 0 detects on each query")
+        ("tiles", boost::program_options::value<std::string>(),
+         "Also detect in a COLUMNSxROWS grid of overlapping tiles (e.g. 3x2) to find small "
+         "objects in high resolution frames; 1x1 disables tiling")
+        ("tile-overlap", boost::program_options::value<double>(),
+         "Fraction of a tile shared with its neighbours");
 
     boost::program_options::options_description opt("Options");
     opt.add(cmdline_opt);
@@ -72,6 +129,99 @@ void Parameter::parse(int argc, char **argv) {
     if(parameters.count("emulation")) {
       m_is_emulation_mode = true;
     }
+    if(parameters.count("segment-size")) {
+      m_segment_size = parameters["segment-size"].as<size_t>();
+      // A segment must fit in one NDN packet (8800 bytes) together with its
+      // name and signature.
+      if(m_segment_size < 256 || m_segment_size > 8000) {
+        throw std::invalid_argument("segment-size must be between 256 and 8000");
+      }
+    }
+    if(parameters.count("store-versions")) {
+      m_store_versions = parameters["store-versions"].as<size_t>();
+      if(m_store_versions < 1) {
+        throw std::invalid_argument("store-versions must be at least 1");
+      }
+    }
+    if(parameters.count("store-memory")) {
+      m_store_bytes = parameters["store-memory"].as<size_t>() * 1024 * 1024;
+    }
+    if(parameters.count("store-age")) {
+      m_store_age = parameters["store-age"].as<size_t>();
+    }
+    if(parameters.count("model")) {
+      m_model = parameters["model"].as<std::string>();
+      // Models shipped in ./config can be given by name.
+      if(m_model == "yolov3" || m_model == "yolov3-tiny") {
+        m_model_config = "./config/" + m_model + ".cfg";
+        m_model = "./config/" + m_model + ".weights";
+      } else {
+        m_model_config.clear();
+      }
+    }
+    if(parameters.count("model-config")) {
+      m_model_config = parameters["model-config"].as<std::string>();
+    }
+    if(parameters.count("classes")) {
+      m_classes_file = parameters["classes"].as<std::string>();
+    }
+    if(parameters.count("input-size")) {
+      m_input_size = parameters["input-size"].as<int>();
+      if(m_input_size < 32 || m_input_size % 32 != 0) {
+        throw std::invalid_argument("input-size must be a positive multiple of 32");
+      }
+    }
+    if(parameters.count("backend")) {
+      m_backend = parameters["backend"].as<std::string>();
+      if(m_backend != "opencv" && m_backend != "inference-engine") {
+        throw std::invalid_argument("backend must be opencv or inference-engine");
+      }
+    }
+    if(parameters.count("precision")) {
+      m_precision = parameters["precision"].as<std::string>();
+      if(m_precision != "fp32" && m_precision != "fp16") {
+        throw std::invalid_argument("precision must be fp32 or fp16");
+      }
+    }
+    if(parameters.count("annotate")) {
+      m_is_annotate_mode = true;
+    }
+    if(parameters.count("snapshot-dir")) {
+      m_snapshot_dir = parameters["snapshot-dir"].as<std::string>();
+    }
+    if(parameters.count("snapshot-rate")) {
+      m_snapshot_rate = parameters["snapshot-rate"].as<double>();
+      if(m_snapshot_rate < 0.0) {
+        throw std::invalid_argument("snapshot-rate must not be negative");
+      }
+    }
+    if(parameters.count("change-threshold")) {
+      m_change_threshold = parameters["change-threshold"].as<int>();
+      if(m_change_threshold < 0 || m_change_threshold > 255) {
+        throw std::invalid_argument("change-threshold must be between 0 and 255");
+      }
+    }
+    if(parameters.count("inference-rate")) {
+      m_inference_rate = parameters["inference-rate"].as<double>();
+      if(m_inference_rate < 0.0) {
+        throw std::invalid_argument("inference-rate must not be negative");
+      }
+    }
+    if(parameters.count("tiles")) {
+      const std::string tiles = parameters["tiles"].as<std::string>();
+      char separator = '\0';
+      std::istringstream iss(tiles);
+      if(!(iss >> m_tile_columns >> separator >> m_tile_rows) || separator != 'x' ||
+         m_tile_columns < 1 || m_tile_rows < 1) {
+        throw std::invalid_argument("tiles must be given as COLUMNSxROWS, e.g. 3x2");
+      }
+    }
+    if(parameters.count("tile-overlap")) {
+      m_tile_overlap = parameters["tile-overlap"].as<double>();
+      if(m_tile_overlap < 0.0 || m_tile_overlap >= 1.0) {
+        throw std::invalid_argument("tile-overlap must be at least 0 and less than 1");
+      }
+    }
 
   } catch(std::exception &e) {
     std::cerr << "error: " << e.what() << std::endl;
@@ -94,6 +244,23 @@ void Parameter::print(std::ostream &os) const {
   os << console_format % "Time name" % m_time_name << std::endl;
   os << console_format % "Dummy mode" % (Parameter::instance().is_dummy_mode() ? "On" : "Off") << std::endl;
   os << console_format % "Emulation mode" % (Parameter::instance().is_emulation_mode() ? "On" : "Off") << std::endl;
+  os << console_format % "Segment size" % m_segment_size << std::endl;
+  os << console_format % "Stored frame versions" % m_store_versions << std::endl;
+  os << console_format % "Stored frame memory [bytes]" % m_store_bytes << std::endl;
+  os << console_format % "Stored frame age [ms]" % m_store_age << std::endl;
+  os << console_format % "Model" % m_model << std::endl;
+  os << console_format % "Model configuration" % m_model_config << std::endl;
+  os << console_format % "Model classes" % m_classes_file << std::endl;
+  os << console_format % "Model input size" % m_input_size << std::endl;
+  os << console_format % "DNN backend" % m_backend << std::endl;
+  os << console_format % "DNN precision" % m_precision << std::endl;
+  os << console_format % "Annotation" % (m_is_annotate_mode ? "On" : "Off") << std::endl;
+  os << console_format % "Snapshot directory" % m_snapshot_dir << std::endl;
+  os << console_format % "Snapshot rate [1/s]" % m_snapshot_rate << std::endl;
+  os << console_format % "Scene change threshold" % m_change_threshold << std::endl;
+  os << console_format % "Background inference rate [1/s]" % m_inference_rate << std::endl;
+  os << console_format % "Detection tiles" % (std::to_string(m_tile_columns) + "x" + std::to_string(m_tile_rows)) << std::endl;
+  os << console_format % "Detection tile overlap" % m_tile_overlap << std::endl;
   os << std::endl;
 
   return;
@@ -26,6 +26,7 @@
 #ifndef PARAMETER_HPP_INC
 #define PARAMETER_HPP_INC
 
+#include <cstddef>
 #include <string>
 
 class Parameter
@@ -50,6 +51,27 @@ class Parameter
   bool is_dummy_mode() const { return m_is_dummy_mode; }
   bool is_emulation_mode() const { return m_is_emulation_mode; }
 
+  size_t segment_size() const { return m_segment_size; }
+  size_t store_versions() const { return m_store_versions; }
+  size_t store_bytes() const { return m_store_bytes; }
+  size_t store_age() const { return m_store_age; }
+
+  // Object detection model and how it is run
+  const std::string &model() const { return m_model; }
+  const std::string &model_config() const { return m_model_config; }
+  const std::string &classes_file() const { return m_classes_file; }
+  int input_size() const { return m_input_size; }
+  const std::string &backend() const { return m_backend; }
+  const std::string &precision() const { return m_precision; }
+  bool is_annotate_mode() const { return m_is_annotate_mode; }
+  const std::string &snapshot_dir() const { return m_snapshot_dir; }
+  double snapshot_rate() const { return m_snapshot_rate; }
+  int change_threshold() const { return m_change_threshold; }
+  double inference_rate() const { return m_inference_rate; }
+  int tile_columns() const { return m_tile_columns; }
+  int tile_rows() const { return m_tile_rows; }
+  double tile_overlap() const { return m_tile_overlap; }
+
  private:
   Parameter();
 
@@ -63,6 +85,26 @@ class Parameter
   std::string m_dummy_file;
   bool        m_is_dummy_mode;
   bool        m_is_emulation_mode;
+
+  size_t      m_segment_size;
+  size_t      m_store_versions;
+  size_t      m_store_bytes;
+  size_t      m_store_age;
+
+  std::string m_model;
+  std::string m_model_config;
+  std::string m_classes_file;
+  int         m_input_size;
+  std::string m_backend;
+  std::string m_precision;
+  bool        m_is_annotate_mode;
+  std::string m_snapshot_dir;
+  double      m_snapshot_rate;
+  int         m_change_threshold;
+  double      m_inference_rate;
+  int         m_tile_columns;
+  int         m_tile_rows;
+  double      m_tile_overlap;
 };
 
 std::ostream &operator<<(std::ostream &os, const Parameter &obj);
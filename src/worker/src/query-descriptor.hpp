@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#ifndef QUERY_DESCRIPTOR_HPP_INC
+#define QUERY_DESCRIPTOR_HPP_INC
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/utility/string_view.hpp>
+#include <ndn-cxx/encoding/block.hpp>
+
+// TLV-TYPEs of QueryDescriptor, in the application range of NDN.
+namespace query_tlv {
+enum : uint32_t {
+  QueryDescriptor = 200,
+  EdgeMode = 201,
+  Location = 202,
+  Target = 203,
+  Deadline = 204,
+  ResultOptions = 205,
+  SessionId = 206,
+  // 207-210 held the frame request of cloud mode, which is now named instead
+  Region = 211,
+  LocationRange = 212,
+  LocationBox = 213,
+  ClassList = 214
+};
+}  // namespace query_tlv
+
+// Binary form of a query, carried in the ApplicationParameters of query
+// Interests so that neither the edge nor the workers have to escape and
+// parse the query text of the name. The edge sends it to workers in edge
+// mode only: cloud-mode fetches go through SegmentFetcher, which would copy
+// it, and its parameters digest, into every segment Interest. All numbers
+// are NonNegativeIntegers:
+//
+//   QueryDescriptor = 200 TLV-LENGTH
+//                       EdgeMode         'e' or 'c'
+//                       *Location        Z-order code, see location_code()
+//                       *Region          Z-order prefix, answered by an aggregator
+//                       *LocationRange   first and last Location in Z-order
+//                       *LocationBox     Locations of two opposite corners
+//                       *Target          index into the class list of the model
+//                       [ClassList]      class_list_hash() of that class list
+//                       [Deadline]       milliseconds since the UNIX epoch
+//                       [ResultOptions]  QueryDescriptor::Option flags
+//                       [SessionId]
+//
+// Unknown elements are skipped, so that fields can be added. Ranges and boxes come from
+// consumers only; the edge decomposes them into Regions, see ZOrder.
+struct QueryDescriptor {
+  enum Option : uint32_t {
+    REPORT_AGE = 1,  // answers carry the age of the detection result
+  };
+
+  struct Span {
+    uint64_t first;
+    uint64_t last;
+  };
+
+  uint8_t edge_mode = 'c';
+  std::vector<uint64_t> locations;
+  std::vector<uint64_t> regions;
+  std::vector<Span> ranges;
+  std::vector<Span> boxes;
+  std::vector<uint32_t> targets;
+  uint64_t class_list = 0;  // 0 if unknown
+  uint64_t deadline = 0;  // 0 for none
+  uint32_t options = 0;
+  uint64_t session_id = 0;
+
+  ndn::Block encode() const;
+  // Decodes the ApplicationParameters of an Interest. Returns false if they
+  // do not hold a descriptor, e.g. for the one-byte parameters of old edges.
+  bool decode(const ndn::Block &parameters);
+
+  bool is_expired(uint64_t now) const { return deadline != 0 && now > deadline; }
+
+  // Maps target class names to indices into class_names. Returns false if
+  // a name is not in class_names; the known ones are set nevertheless.
+  bool set_targets(const std::vector<std::string> &names,
+                   const std::vector<std::string> &class_names);
+  std::vector<std::string> target_names(const std::vector<std::string> &class_names) const;
+  // FNV-1a hash of class_names. Sites may run different models, so workers
+  // refuse targets that index into a class list other than their own.
+  static uint64_t class_list_hash(const std::vector<std::string> &class_names);
+
+  // Location names such as "30321" are strings of base-4 digits that start
+  // with a non-zero digit, so the number they spell keeps their length.
+  static bool location_code(boost::string_view location, uint64_t &code);
+  static std::string location_name(uint64_t code);
+};
+
+#endif
@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#include "query-name.hpp"
+
+namespace {
+boost::string_view view_of(const ndn::name::Component &component)
+{
+  return boost::string_view(reinterpret_cast<const char *>(component.value()),
+                            component.value_size());
+}
+
+ndn::name::Component component_of(boost::string_view value)
+{
+  return ndn::name::Component(reinterpret_cast<const uint8_t *>(value.data()), value.size());
+}
+
+// Splits a key such as "#a:[30321,33212]" into its values; a key without
+// a colon is a single value. Values may hold colons themselves.
+void split_list(boost::string_view key, Query::list_type &list)
+{
+  const size_t colon = key.find(':');
+  if(colon != boost::string_view::npos) {
+    key.remove_prefix(colon + 1);
+  }
+  if(!key.empty() && key.front() == '[') {
+    key.remove_prefix(1);
+  }
+  if(!key.empty() && key.back() == ']') {
+    key.remove_suffix(1);
+  }
+
+  list.clear();
+  while(!key.empty()) {
+    const size_t comma = key.find(',');
+    const boost::string_view value = key.substr(0, comma);
+    if(!value.empty()) {
+      list.push_back(value);
+    }
+    if(comma == boost::string_view::npos) {
+      break;
+    }
+    key.remove_prefix(comma + 1);
+  }
+}
+}  // namespace
+
+std::vector<std::string> Query::to_strings(const list_type &list)
+{
+  std::vector<std::string> strings;
+  strings.reserve(list.size());
+  for(const boost::string_view &value : list) {
+    strings.emplace_back(value.data(), value.size());
+  }
+  return strings;
+}
+
+bool QueryName::parse(const ndn::Name &name, bool with_session, Query &query)
+{
+  size_t end = name.size();
+  if(end > 0 && name[end - 1].isParametersSha256Digest()) {
+    --end;
+  }
+  if(with_session) {
+    if(end == 0) {
+      return false;
+    }
+    --end;
+    query.session_id = view_of(name[end]);
+  } else {
+    query.session_id.clear();
+  }
+  // The function and the query component
+  if(end < 2) {
+    return false;
+  }
+  query.function_index = end - 2;
+  query.function = view_of(name[end - 2]);
+
+  // "<locations key> <targets key>"; the targets key is the last token and
+  // the locations key the one before it.
+  boost::string_view keyword = view_of(name[end - 1]);
+  const size_t target_space = keyword.rfind(' ');
+  if(target_space == boost::string_view::npos) {
+    return false;
+  }
+  query.target_key = keyword.substr(target_space + 1);
+  keyword = keyword.substr(0, target_space);
+  const size_t location_space = keyword.rfind(' ');
+  const boost::string_view location_key =
+      (location_space == boost::string_view::npos) ? keyword : keyword.substr(location_space + 1);
+
+  split_list(location_key, query.locations);
+  split_list(query.target_key, query.targets);
+  return !query.targets.empty();
+}
+
+boost::string_view QueryName::function_of(const ndn::Name &name, bool with_session)
+{
+  size_t end = name.size();
+  if(end > 0 && name[end - 1].isParametersSha256Digest()) {
+    --end;
+  }
+  if(with_session && end > 0) {
+    --end;
+  }
+  return (end > 0) ? view_of(name[end - 1]) : boost::string_view();
+}
+
+ndn::Name QueryName::prefix(boost::string_view location)
+{
+  ndn::Name name;
+  for(size_t i = 0; i < location.size(); ++i) {
+    name.append(component_of(location.substr(i, 1)));
+  }
+  return name;
+}
+
+ndn::Name QueryName::forward(boost::string_view function, boost::string_view location,
+                             uint64_t session_id)
+{
+  ndn::Name name(prefix(location));
+  name.append(component_of(function));
+  name.append(component_of(std::to_string(session_id)));
+  return name;
+}
@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#include "segment-store.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace ndn::literals::time_literals;
+
+SegmentStore::SegmentStore(const Limits &limits) : m_limits(limits), m_bytes(0) {}
+
+SegmentStore::~SegmentStore()
+{
+  for(const auto &entry : m_entries) {
+    report(entry);
+  }
+}
+
+void SegmentStore::insert(const ndn::Name &versioned_prefix, segments_type &&segments)
+{
+  const auto now = std::chrono::steady_clock::now();
+  expire(now);
+
+  auto found = m_index.find(versioned_prefix);
+  if(found != m_index.end()) {
+    evict(found->second);
+  }
+
+  Entry entry;
+  entry.versioned_prefix = versioned_prefix;
+  entry.segments = std::move(segments);
+  for(const auto &data : entry.segments) {
+    entry.bytes += data->wireEncode().size();
+  }
+  entry.created = now;
+
+  m_bytes += entry.bytes;
+  m_entries.push_front(std::move(entry));
+  m_index[versioned_prefix] = m_entries.begin();
+
+  // The newest entry is kept even when it alone exceeds the memory cap, since
+  // its fetch has just been started.
+  while(m_entries.size() > 1 &&
+        (m_entries.size() > m_limits.max_versions || m_bytes > m_limits.max_bytes)) {
+    evict(std::prev(m_entries.end()));
+  }
+}
+
+const ndn::Data *SegmentStore::find(const ndn::Interest &interest)
+{
+  const ndn::Name &name = interest.getName();
+  if(name.size() < 2 || !name[-1].isSegment()) {
+    return nullptr;
+  }
+
+  auto found = m_index.find(PrefixOf{name, name.size() - 1});
+  if(found == m_index.end()) {
+    return nullptr;
+  }
+  const auto it = found->second;
+  const auto segmentNo = static_cast<size_t>(name[-1].toSegment());
+  if(segmentNo >= it->segments.size()) {
+    return nullptr;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  if(it->served == 0) {
+    it->first_served = now;
+  }
+  it->last_served = now;
+  ++it->served;
+  m_entries.splice(m_entries.begin(), m_entries, it);
+
+  return it->segments[segmentNo].get();
+}
+
+SegmentStore::segments_type SegmentStore::segment(const ndn::Name &versioned_prefix,
+                                                  const uint8_t *buffer, size_t length,
+                                                  size_t segment_size, ndn::KeyChain &key_chain,
+                                                  const ndn::security::SigningInfo &signing_info)
+{
+  const size_t num_segments = std::max<size_t>(1, (length + segment_size - 1) / segment_size);
+  const auto finalBlockId = ndn::Name::Component::fromSegment(num_segments - 1);
+
+  segments_type segments;
+  segments.reserve(num_segments);
+  for(size_t i = 0; i < num_segments; ++i) {
+    const size_t offset = std::min(i * segment_size, length);
+    const size_t size = std::min(segment_size, length - offset);
+
+    auto data = std::make_shared<ndn::Data>(ndn::Name(versioned_prefix).appendSegment(i));
+    data->setFreshnessPeriod(10_s);
+    data->setContent(buffer + offset, size);
+    data->setFinalBlock(finalBlockId);
+    key_chain.sign(*data, signing_info);
+    data->wireEncode();
+    segments.push_back(data);
+  }
+  return segments;
+}
+
+void SegmentStore::expire(std::chrono::steady_clock::time_point now)
+{
+  for(auto it = m_entries.begin(); it != m_entries.end();) {
+    auto next = std::next(it);
+    if(now - it->created > m_limits.max_age) {
+      evict(it);
+    }
+    it = next;
+  }
+}
+
+void SegmentStore::evict(list_type::iterator it)
+{
+  report(*it);
+  m_bytes -= it->bytes;
+  m_index.erase(it->versioned_prefix);
+  m_entries.erase(it);
+}
+
+void SegmentStore::report(const Entry &entry) const
+{
+  std::cerr << "[INFO] Dropping " << entry.segments.size() << " segments of "
+            << entry.versioned_prefix << ": served " << entry.served << " segments";
+  const double serve_ms =
+      std::chrono::duration<double, std::milli>(entry.last_served - entry.first_served).count();
+  if(serve_ms > 0.0) {
+    std::cerr << " in " << serve_ms << " ms (" << entry.served * 1000.0 / serve_ms
+              << " segments/s)";
+  }
+  std::cerr << std::endl;
+}
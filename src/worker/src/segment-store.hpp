@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#ifndef SEGMENT_STORE_HPP_INC
+#define SEGMENT_STORE_HPP_INC
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <ndn-cxx/data.hpp>
+#include <ndn-cxx/interest.hpp>
+#include <ndn-cxx/name.hpp>
+#include <ndn-cxx/security/key-chain.hpp>
+#include <ndn-cxx/security/signing-info.hpp>
+
+/**
+ * Signed segments of recently captured frames, one entry per versioned
+ * prefix. Entries are evicted least recently used first once there are more
+ * than max_versions of them or they hold more than max_bytes, and regardless
+ * of use once they are older than max_age (checked on insert). Not
+ * thread-safe; used from the face thread only.
+ */
+class SegmentStore
+{
+ public:
+  using segments_type = std::vector<std::shared_ptr<ndn::Data>>;
+
+  struct Limits {
+    size_t max_versions = 8;
+    size_t max_bytes = 64 * 1024 * 1024;
+    std::chrono::milliseconds max_age = std::chrono::milliseconds(10000);
+  };
+
+ public:
+  explicit SegmentStore(const Limits &limits);
+  ~SegmentStore();
+
+  void insert(const ndn::Name &versioned_prefix, segments_type &&segments);
+  // Returns the segment satisfying interest, or nullptr.
+  const ndn::Data *find(const ndn::Interest &interest);
+
+  // Splits buffer into signed and wire-encoded segments named
+  // versioned_prefix/<segment number>.
+  static segments_type segment(const ndn::Name &versioned_prefix, const uint8_t *buffer,
+                               size_t length, size_t segment_size, ndn::KeyChain &key_chain,
+                               const ndn::security::SigningInfo &signing_info);
+
+  size_t size() const { return m_entries.size(); }
+  size_t bytes() const { return m_bytes; }
+
+ private:
+  struct Entry {
+    ndn::Name versioned_prefix;
+    segments_type segments;
+    size_t bytes = 0;
+    std::chrono::steady_clock::time_point created;
+    uint64_t served = 0;
+    std::chrono::steady_clock::time_point first_served;
+    std::chrono::steady_clock::time_point last_served;
+  };
+  using list_type = std::list<Entry>;
+
+  // The first size components of name, so that segment Interests are looked
+  // up by their versioned prefix without building it as an ndn::Name.
+  struct PrefixOf {
+    const ndn::Name &name;
+    size_t size;
+  };
+  struct NameLess {
+    using is_transparent = void;
+    bool operator()(const ndn::Name &a, const ndn::Name &b) const { return a < b; }
+    bool operator()(const PrefixOf &a, const ndn::Name &b) const
+    {
+      return a.name.compare(0, a.size, b) < 0;
+    }
+    bool operator()(const ndn::Name &a, const PrefixOf &b) const
+    {
+      return b.name.compare(0, b.size, a) > 0;
+    }
+  };
+
+  void expire(std::chrono::steady_clock::time_point now);
+  void evict(list_type::iterator it);
+  void report(const Entry &entry) const;
+
+ private:
+  const Limits m_limits;
+  list_type m_entries;  // most recently used first
+  std::map<ndn::Name, list_type::iterator, NameLess> m_index;
+  size_t m_bytes;
+};
+
+#endif
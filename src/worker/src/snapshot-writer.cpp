@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#include "snapshot-writer.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include <opencv2/imgcodecs.hpp>
+
+namespace {
+std::chrono::steady_clock::duration intervalOf(double rate)
+{
+  if(rate <= 0.0) {
+    return std::chrono::steady_clock::duration::zero();
+  }
+  return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(1.0 / rate));
+}
+}  // namespace
+
+SnapshotWriter::SnapshotWriter(const std::string& directory, double rate, size_t max_queue)
+    : m_directory(directory.empty() ? "." : directory),
+      m_interval(intervalOf(rate)),
+      m_max_queue(std::max<size_t>(max_queue, 1)),
+      m_next(std::chrono::steady_clock::time_point::min()),
+      m_run(false),
+      m_written(0),
+      m_dropped(0)
+{
+  if(isEnabled()) {
+    m_run = true;
+    m_thread = std::thread([this]() { this->run(); });
+  }
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+  if(m_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_run = false;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+    std::cerr << "[INFO] Snapshots: " << m_written << " written, " << m_dropped << " dropped"
+              << std::endl;
+  }
+}
+
+bool SnapshotWriter::isDue()
+{
+  if(!isEnabled()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return std::chrono::steady_clock::now() >= m_next && m_snapshots.size() < m_max_queue;
+}
+
+bool SnapshotWriter::submit(const std::string& name, const cv::Mat& image,
+                            std::shared_ptr<const void> owner)
+{
+  if(!isEnabled() || image.empty()) {
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto now = std::chrono::steady_clock::now();
+    if(now < m_next || m_snapshots.size() >= m_max_queue) {
+      ++m_dropped;
+      return false;
+    }
+    m_next = now + m_interval;
+    m_snapshots.push_back(Snapshot{m_directory + "/" + name, image, std::move(owner)});
+  }
+  m_cond.notify_one();
+  return true;
+}
+
+void SnapshotWriter::run()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while(true) {
+    m_cond.wait(lock, [this] { return !m_run || !m_snapshots.empty(); });
+    if(m_snapshots.empty()) {
+      break;
+    }
+    Snapshot snapshot = std::move(m_snapshots.front());
+    m_snapshots.pop_front();
+
+    lock.unlock();
+    try {
+      if(cv::imwrite(snapshot.path, snapshot.image)) {
+        ++m_written;
+      } else {
+        std::cerr << "[WARN] Cannot write snapshot " << snapshot.path << std::endl;
+      }
+    } catch(const cv::Exception& e) {
+      std::cerr << "[WARN] Cannot write snapshot " << snapshot.path << ": " << e.what()
+                << std::endl;
+    }
+    // Release the frame before waiting for the next one.
+    snapshot = Snapshot();
+    lock.lock();
+  }
+}
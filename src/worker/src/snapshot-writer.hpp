@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#ifndef SNAPSHOT_WRITER_HPP_INC
+#define SNAPSHOT_WRITER_HPP_INC
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <boost/noncopyable.hpp>
+#include <opencv2/core.hpp>
+
+// Writes debugging snapshots of frames to disk on its own thread.
+//
+// submit() never waits for encoding or I/O: a snapshot is dropped when it
+// comes less than 1 / rate seconds after the previously accepted one or
+// when max_queue snapshots are still waiting to be written. A rate of 0
+// disables the writer; no thread is started then.
+class SnapshotWriter : boost::noncopyable {
+ public:
+  SnapshotWriter(const std::string& directory, double rate, size_t max_queue = 2);
+  ~SnapshotWriter();
+
+  bool isEnabled() const { return m_interval.count() > 0; }
+  // True if a snapshot submitted now would be accepted; lets callers skip
+  // preparing images that would only be dropped.
+  bool isDue();
+
+  // Queues image to be written as directory/name. The image is not copied;
+  // owner, if given, is kept alive until the image has been written, for
+  // images whose buffer is owned by something else. Returns false if the
+  // snapshot was dropped.
+  bool submit(const std::string& name, const cv::Mat& image,
+              std::shared_ptr<const void> owner = nullptr);
+
+  uint64_t written() const { return m_written; }
+  uint64_t dropped() const { return m_dropped; }
+
+ private:
+  struct Snapshot {
+    std::string path;
+    cv::Mat image;
+    std::shared_ptr<const void> owner;
+  };
+
+  void run();
+
+ private:
+  const std::string m_directory;
+  const std::chrono::steady_clock::duration m_interval;
+  const size_t m_max_queue;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<Snapshot> m_snapshots;
+  std::chrono::steady_clock::time_point m_next;
+  bool m_run;
+
+  std::atomic<uint64_t> m_written;
+  std::atomic<uint64_t> m_dropped;
+
+  std::thread m_thread;
+};
+
+#endif
@@ -35,10 +35,8 @@
 #include <sstream>
 #include <thread>
 
-#include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/replace.hpp>
-#include <boost/algorithm/string/split.hpp>
 #include <boost/bind.hpp>
 #include <vector>
 
@@ -53,10 +51,14 @@
 
 #include "decode.hpp"
 #include "encode.hpp"
+#include "frame-codec.hpp"
+#include "query-descriptor.hpp"
+#include "query-name.hpp"
+#include "segment-store.hpp"
 
 using namespace ndn::literals::time_literals;
 
-Worker::Worker(const std::string& cd_str, detector_ptr detector)
+Worker::Worker(const std::string& cd_str, const Options& options, detector_ptr detector)
     : m_cd_string(cd_str),
       m_detector(detector),
       m_num_thread(1),
@@ -66,7 +68,11 @@ Worker::Worker(const std::string& cd_str, detector_ptr detector)
       m_worker_pool(),
       m_thread_pool(),
       m_timer_service(),
-      m_id_generator(1)
+      m_id_generator(1),
+      m_options(options),
+      m_store(options.storeLimits),
+      m_last_version(0),
+      m_class_list(QueryDescriptor::class_list_hash(detector->classNames()))
 {
   for(auto&& ios : m_io_service_pool) {
     m_worker_pool.emplace_back(ios);
@@ -98,6 +104,18 @@ void Worker::run()
     this->m_ndn_face.processEvents();
   });
 
+  // The model is loaded while the face is up already. If that fails, the
+  // face and the timers are shut down and the failure is thrown to the caller.
+  try {
+    m_detector->waitReady();
+  } catch(...) {
+    m_ndn_face.getIoService().post([this] { this->m_ndn_face.shutdown(); });
+    m_timer_worker.reset();
+    m_timer_service.stop();
+    timer_thread.join();
+    ndn_thread.join();
+    throw;
+  }
   timer_thread.join();
   ndn_thread.join();
   return;
@@ -112,49 +130,103 @@ void Worker::onInterest(const ndn::InterestFilter& filter, const ndn::Interest&
   ss.clear();
   ss.str("");
 
-  std::string edge_mode = "c";
-  if(interest.hasApplicationParameters()) {
-    std::string param(interest.getApplicationParameters().value(),
-                      interest.getApplicationParameters().value() + interest.getApplicationParameters().value_size());
-    std::cerr << "parameter  oK: " << param << std::endl;
-    edge_mode = param;
+  // Parameters: a QueryDescriptor or, from older edges, the edge mode ('e' or
+  // 'c'). Cloud-mode Interests come without parameters; they name the frame
+  // they ask for instead, see FrameCodec::request_key().
+  char edge_mode = 'c';
+  QueryDescriptor descriptor;
+  const bool has_descriptor =
+      interest.hasApplicationParameters() && descriptor.decode(interest.getApplicationParameters());
+  if(has_descriptor) {
+    edge_mode = static_cast<char>(descriptor.edge_mode);
+  } else if(interest.hasApplicationParameters()) {
+    const ndn::Block& param = interest.getApplicationParameters();
+    if(param.value_size() >= 1) {
+      edge_mode = static_cast<char>(param.value()[0]);
+    }
+    std::cerr << "parameter  oK: " << edge_mode << std::endl;
   }
 
-  std::vector<std::string> target_name(ExtractTargets(decodeURI(interest.getName().toUri())));
-  std::string session_id(ExtractSessionID(decodeURI(interest.getName().toUri())));
+  const uint64_t received = ndn::time::toUnixTimestamp(ndn::time::system_clock::now()).count();
 
-  if(target_name.size() == 0) {
-    std::cerr << "Target is not properly specified." << std::endl;
-    return;
-  }
-  if(edge_mode == "e") {
-    std::vector<std::string> detection_result;
-    m_detector->detect(detection_result);
+  if(edge_mode == 'e') {
+    std::vector<std::string> target_name;
+    std::string session_id;
+    if(has_descriptor) {
+      if(descriptor.is_expired(received)) {
+        std::cerr << "[WARN] Query " << descriptor.session_id << " is past its deadline, dropped"
+                  << std::endl;
+        return;
+      }
+      if(descriptor.class_list != m_class_list) {
+        // The target indices would name other classes of our model.
+        std::cerr << "[WARN] Query " << descriptor.session_id
+                  << " indexes another class list than ours, sending Nack" << std::endl;
+        m_ndn_face.put(ndn::lp::Nack(interest));
+        return;
+      }
+      target_name = descriptor.target_names(m_detector->classNames());
+      session_id = std::to_string(descriptor.session_id);
+    } else {
+      Query query;
+      if(!QueryName::parse(interest.getName(), true, query)) {
+        std::cerr << "Target is not properly specified." << std::endl;
+        return;
+      }
+      target_name = Query::to_strings(query.targets);
+      session_id.assign(query.session_id.data(), query.session_id.size());
+      descriptor.options = QueryDescriptor::REPORT_AGE;
+    }
+    if(target_name.empty()) {
+      std::cerr << "Target is not properly specified." << std::endl;
+      return;
+    }
 
-    std::cerr << "Specified target: [" << target_name[0] << "]" << std::endl;
+    if(!m_detector->isReady()) {
+      // The edge treats this like any other Nack; the query can be retried
+      // once the model is warm.
+      std::cerr << "[WARN] Detector is warming up, sending Nack" << std::endl;
+      ndn::lp::Nack nack(interest);
+      nack.setReason(ndn::lp::NackReason::CONGESTION);
+      m_ndn_face.put(nack);
+      return;
+    }
+    const detection_set_ptr detected = m_detector->detect();
+    if(!detected) {
+      std::cerr << "[WARN] No detection result yet, sending Nack" << std::endl;
+      ndn::lp::Nack nack(interest);
+      nack.setReason(ndn::lp::NackReason::CONGESTION);
+      m_ndn_face.put(nack);
+      return;
+    }
+    const std::vector<Detection>& detection_result = detected->detections;
+    int64_t age_ms = -1;
+    if(descriptor.options & QueryDescriptor::REPORT_AGE) {
+      age_ms = received > detected->timestamp ? received - detected->timestamp : 0;
+    }
+
+    std::cerr << "Specified targets: [" << boost::algorithm::join(target_name, ",") << "]"
+              << std::endl;
     std::cerr << "List of detected objects: [" << std::endl;
-    for(const std::string& line : detection_result) {
-      std::cerr << line << std::endl;
+    for(const Detection& detection : detection_result) {
+      std::cerr << m_detector->classNames()[detection.class_id] << std::endl;
     }
     std::cerr << "]" << std::endl;
 
-    bool is_found = false;
-    if(std::find(detection_result.begin(), detection_result.end(), target_name[0]) !=
-       detection_result.end()) {
-      std::cout << "------------------------------------" << std::endl;
-      std::cout << "----------[Target Found!]-----------" << std::endl;
-      std::cout << "------------------------------------" << std::endl;
-      is_found = true;
-    } else {
-      std::cout << "------------------------------------" << std::endl;
-      std::cout << "--------[Target Not Found!]---------" << std::endl;
-      std::cout << "------------------------------------" << std::endl;
-      is_found = false;
+    // Every requested target is answered from the same detection pass.
+    std::vector<bool> found_list;
+    found_list.reserve(target_name.size());
+    for(const std::string& target : target_name) {
+      const bool is_found = m_detector->contains(detection_result, target);
+      std::cout << "[" << target << "] " << (is_found ? "Target Found!" : "Target Not Found!")
+                << std::endl;
+      found_list.push_back(is_found);
     }
 
     std::string m_location(m_cd_string);
     boost::algorithm::replace_all(m_location, "/", "");
-    std::string result_str = Encoder::encode(m_location, "", target_name[0], is_found, session_id);
+    std::string result_str =
+        Encoder::encode(m_location, "", target_name, found_list, session_id, age_ms);
     std::vector<uint8_t> data_vector;
     std::copy(result_str.begin(), result_str.end(), std::back_inserter(data_vector));
 
@@ -167,31 +239,74 @@ void Worker::onInterest(const ndn::InterestFilter& filter, const ndn::Interest&
     std::cerr << "Sending Data: " << *data << std::endl;
 
     m_ndn_face.put(*data);
-  } else if(edge_mode == "c") {  // cloud mode--------------------------
-
-    // if(m_store.empty()){
-    if(!interest.getName()[-1].isSegment()) {
-      cv::Mat raw = m_detector->returnMat();
-
-      std::cout << raw.rows << " " << raw.cols << " " << raw.dims << " " << raw.channels()
-                << std::endl;
-      raw = raw.reshape(1, 1);
-
-      std::vector<uint8_t> data_vector = raw;
+  } else if(edge_mode == 'c') {  // cloud mode--------------------------
+
+    // Each new frame gets its own version, so a fetch in progress keeps
+    // being served from its version while other edges capture newer ones.
+    const ndn::Name& prefix = interest.getName();
+    if(prefix.size() == 0 || !prefix[-1].isSegment()) {
+      // The frame is encoded in place; |captured| keeps the capture thread
+      // from reusing its buffer meanwhile.
+      const frame_ptr captured = m_detector->latestFrame();
+      if(!captured || captured->image.empty()) {
+        std::cerr << "No frame has been captured yet, sending Nack" << std::endl;
+        m_ndn_face.put(ndn::lp::Nack(interest));
+        return;
+      }
+      // The frame request is the last component but the version, if any.
+      FrameRequest frame_request;
+      const bool is_versioned = prefix.size() > 0 && prefix[-1].isVersion();
+      if(prefix.size() > (is_versioned ? 1u : 0u)) {
+        const ndn::name::Component& key = prefix[is_versioned ? -2 : -1];
+        if(!FrameCodec::parse_request_key(
+               std::string(reinterpret_cast<const char*>(key.value()), key.value_size()),
+               frame_request)) {
+          frame_request = FrameRequest();
+        }
+      }
 
-      ndn::Name prefix = interest.getName();
+      const auto encode_start = std::chrono::steady_clock::now();
+      FrameHeader header;
+      // Without a requested size, raw refers to the captured frame itself.
+      const cv::Mat raw = FrameCodec::letterbox(
+          captured->image, cv::Size(frame_request.width, frame_request.height), header);
+
+      header.rows = raw.rows;
+      header.cols = raw.cols;
+      header.type = raw.type();
+      header.timestamp = captured->timestamp;
+
+      // The first FrameHeader::size bytes are filled in by populateStore().
+      std::vector<uint8_t> data_vector(FrameHeader::size);
+      header.codec = FrameCodec::encode(raw, frame_request, data_vector);
+      const double encode_ms = std::chrono::duration<double, std::milli>(
+                                   std::chrono::steady_clock::now() - encode_start)
+                                   .count();
+      // Compared with the captured frame, so letterboxing counts as savings.
+      const size_t raw_size = captured->image.total() * captured->image.elemSize();
+      const size_t encoded_size = data_vector.size() - FrameHeader::size;
+      std::cerr << "[INFO] Encoded " << header.source_cols << "x" << header.source_rows
+                << " frame at " << raw.cols << "x" << raw.rows << " as "
+                << FrameCodec::to_string(header.codec) << ": "
+                << raw_size << " -> " << encoded_size << " bytes ("
+                << (encoded_size == 0 ? 0.0 : static_cast<double>(raw_size) / encoded_size)
+                << "x) in " << encode_ms << " ms" << std::endl;
+
+      ndn::Name versioned_prefix;
       if(prefix.size() > 0 && prefix[-1].isVersion()) {
-        m_prefix = prefix.getPrefix(-1);
-        m_versionedPrefix = prefix;
+        versioned_prefix = prefix;
       } else {
-        m_prefix = prefix;
-        m_versionedPrefix = ndn::Name(m_prefix).appendVersion();
+        // Versions are millisecond timestamps; bump concurrent captures
+        // within the same millisecond so that they do not collide.
+        const uint64_t now = ndn::time::toUnixTimestamp(ndn::time::system_clock::now()).count();
+        m_last_version = std::max(now, m_last_version + 1);
+        versioned_prefix = ndn::Name(prefix).appendVersion(m_last_version);
       }
 
-      m_store.clear();
-      // populateStore(is);
-      populateStore(data_vector);
-      processSegmentInterest(interest);
+      SegmentStore::segments_type segments = populateStore(versioned_prefix, header, data_vector);
+      const std::shared_ptr<ndn::Data> first = segments.front();
+      m_store.insert(versioned_prefix, std::move(segments));
+      m_ndn_face.put(*first);
     } else {
       processSegmentInterest(interest);
     }
@@ -205,130 +320,33 @@ void Worker::onRegisterFailed(const ndn::Name& prefix, const std::string& reason
   m_ndn_face_ptr->shutdown();
 }
 
-std::string Worker::ExtractSessionID(const std::string& interest_name)
+SegmentStore::segments_type Worker::populateStore(const ndn::Name& versioned_prefix,
+                                                  const FrameHeader& header,
+                                                  std::vector<uint8_t>& data_vector)
 {
-  std::vector<std::string> token_list;
-  boost::algorithm::split(token_list, interest_name, boost::is_any_of("/"));
-
-  std::string sessionID(token_list.back());
-
-  return sessionID;
-}
-
-std::vector<std::string> Worker::ExtractTargets(const std::string& interest_name)
-{
-  std::vector<std::string> token_list;
-  boost::algorithm::split(token_list, interest_name, boost::is_any_of("/"));
-
-  token_list.pop_back();
-  std::string keyword(token_list.back());
-  std::vector<std::string> key_list;
-  boost::algorithm::split(key_list, keyword, boost::is_any_of(" "));
-
-  std::string material(key_list.back());
-  std::vector<std::string> material_list;
-  boost::algorithm::split(material_list, material, boost::is_any_of(":"));
-
-  std::string target(material_list.back());
-  boost::algorithm::replace_all(target, "[", "");
-  boost::algorithm::replace_all(target, "]", "");
-
-  std::vector<std::string> target_list;
-  boost::algorithm::split(target_list, target, boost::is_any_of(","));
-
-  return target_list;
-}
-
-std::string Worker::decodeURI(const std::string& uri)
-{
-  std::string replaced_string(uri);
-
-  boost::algorithm::replace_all(replaced_string, "%23", "#");
-  boost::algorithm::replace_all(replaced_string, "%3A", ":");
-  boost::algorithm::replace_all(replaced_string, "%2C", ",");
-  boost::algorithm::replace_all(replaced_string, "%5B", "[");
-  boost::algorithm::replace_all(replaced_string, "%5D", "]");
-  boost::algorithm::replace_all(replaced_string, "%20", " ");
-  boost::algorithm::replace_all(replaced_string, "%27", "'");
-  boost::algorithm::replace_all(replaced_string, "%28", "(");
-  boost::algorithm::replace_all(replaced_string, "%29", ")");
-  boost::algorithm::replace_all(replaced_string, "%2A", "*");
-
-  return replaced_string;
-}
-
-void Worker::populateStore(std::vector<uint8_t> data_vector)
-{
-  // BOOST_ASSERT(m_store.empty());
-  std::cerr << "Loading input ..." << std::endl;
-
-  // std::vector<uint8_t> buffer(m_options.maxSegmentSize);
-  std::vector<uint8_t> buffer(m_options.maxSegmentSize);
-  int i = 0;
-  while(m_options.maxSegmentSize * i < data_vector.size()) {
-    // is.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
-    if(m_options.maxSegmentSize * (i + 1) < data_vector.size()) {
-      std::copy(data_vector.begin() + m_options.maxSegmentSize * i,
-                data_vector.begin() + m_options.maxSegmentSize * (i + 1), buffer.begin());
-    } else {
-      buffer.resize(data_vector.end() - (data_vector.begin() + m_options.maxSegmentSize * i));
-      std::copy(data_vector.begin() + m_options.maxSegmentSize * i, data_vector.end(),
-                buffer.begin());
-    }
-    const auto nCharsRead = buffer.size();
-    std::cerr << nCharsRead << std::endl;
-
-    if(nCharsRead > 0) {
-      // ndn::Name interestname = interest.getName();
-      auto data =
-          ndn::make_shared<ndn::Data>(ndn::Name(m_versionedPrefix).appendSegment(m_store.size()));
-      data->setFreshnessPeriod(10_s);
-      data->setContent(buffer.data(), static_cast<size_t>(nCharsRead));
-      m_store.push_back(data);
-    }
-    i++;
-  }
-
-  if(m_store.empty()) {
-    // ndn::Name interestname = interest.getName();
-    auto data = ndn::make_shared<ndn::Data>(ndn::Name(m_versionedPrefix).appendSegment(0));
-    data->setFreshnessPeriod(10_s);
-    m_store.push_back(data);
-  }
-
-  auto finalBlockId = ndn::Name::Component::fromSegment(m_store.size() - 1);
-  for(const auto& data : m_store) {
-    data->setFinalBlock(finalBlockId);
-    // m_key_chain.sign(*data,m_options.signingInfo);
-  }
-
-  std::cerr << "Created " << m_store.size() << " chunks for prefix " << m_prefix << std::endl;
+  BOOST_ASSERT(data_vector.size() >= FrameHeader::size);
+  header.encode(data_vector.data());
+
+  // Every segment is finalized, signed and wire-encoded here once per frame
+  // version, so that processSegmentInterest() only has to hand it to the face.
+  const auto populate_start = std::chrono::steady_clock::now();
+  SegmentStore::segments_type segments =
+      SegmentStore::segment(versioned_prefix, data_vector.data(), data_vector.size(),
+                            m_options.maxSegmentSize, m_key_chain, m_options.signingInfo);
+
+  const double populate_ms = std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - populate_start)
+                                 .count();
+  std::cerr << "[INFO] Created " << segments.size() << " signed segments for prefix "
+            << versioned_prefix << " in " << populate_ms << " ms (" << m_store.size()
+            << " frames, " << m_store.bytes() << " bytes already stored)" << std::endl;
+  return segments;
 }
 
 void Worker::processSegmentInterest(const ndn::Interest& interest)
 {
-  BOOST_ASSERT(m_store.size() > 0);
-
-  // std::cerr << " Interest: " << interest << std::endl;
-
-  const ndn::Name& name = interest.getName();
-  // std::cout<< name[-1] << std::endl;
-  ndn::shared_ptr<ndn::Data> data;
-
-  if(name.size() == m_versionedPrefix.size() + 1 && name[-1].isSegment()) {
-    const auto segmentNo = static_cast<size_t>(interest.getName()[-1].toSegment());
-    // specific segment retrieval
-    std::cerr << segmentNo << std::endl;
-    if(segmentNo < m_store.size()) {
-      data = m_store[segmentNo];
-    }
-  } else if(interest.matchesData(*m_store[0])) {
-    std::cerr << "unspecified version or segment number, return first segment" << std::endl;
-    data = m_store[0];
-  }
-  m_key_chain.sign(*data);
+  const ndn::Data* data = m_store.find(interest);
   if(data != nullptr) {
-    std::cerr << "Data: " << *data << std::endl;
     m_ndn_face.put(*data);
   } else {
     std::cerr << "Interest cannot be satisfied, sending Nack" << std::endl;
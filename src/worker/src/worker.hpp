@@ -27,6 +27,7 @@
 #ifndef WORKER_HPP_INC
 #define WORKER_HPP_INC
 
+#include <chrono>
 #include <memory>
 #include <random>
 #include <thread>
@@ -41,7 +42,9 @@
 #include <ndn-cxx/security/key-chain.hpp>
 #include <ndn-cxx/util/time.hpp>
 
+#include "frame-codec.hpp"
 #include "objectdetection.hpp"
+#include "segment-store.hpp"
 
 namespace ndn {
 class Interest;
@@ -54,7 +57,9 @@ class Worker;
 
 class Worker : boost::noncopyable {
  public:
-  Worker(const std::string& cd_str, detector_ptr detector);
+  struct Options;
+
+  Worker(const std::string& cd_str, const Options& options, detector_ptr detector);
   ~Worker();
   void run();
 
@@ -65,6 +70,7 @@ class Worker : boost::noncopyable {
     ndn::security::SigningInfo signingInfo;
     // ndn::time freshnessPeriod = 10000;
     size_t maxSegmentSize = 8000;
+    SegmentStore::Limits storeLimits;
     bool isQuiet = false;
     bool isVerbose = false;
     bool wantShowVersion = false;
@@ -91,20 +97,20 @@ class Worker : boost::noncopyable {
 
   std::mt19937_64 m_id_generator;
 
-  ndn::Name m_prefix;
-  ndn::Name m_versionedPrefix;
   const Options m_options;
 
-  NDN_CXX_PUBLIC_WITH_TESTS_ELSE_PRIVATE : std::vector<std::shared_ptr<ndn::Data>> m_store;
+  NDN_CXX_PUBLIC_WITH_TESTS_ELSE_PRIVATE : SegmentStore m_store;
+  uint64_t m_last_version;
+  // QueryDescriptor::class_list_hash() of the detector's classes
+  const uint64_t m_class_list;
 
  private:
   void onInterest(const ndn::InterestFilter& filter, const ndn::Interest& interest);
   void onRegisterFailed(const ndn::Name& prefix, const std::string& reason);
-  std::string ExtractSessionID(const std::string& interest_name);
-  std::vector<std::string> ExtractTargets(const std::string& interest_name);
-  std::string decodeURI(const std::string& uri);
   void processSegmentInterest(const ndn::Interest& interest);
   // void populateStore(std::istream& is);
-  void populateStore(std::vector<uint8_t> data_vector);
+  SegmentStore::segments_type populateStore(const ndn::Name& versioned_prefix,
+                                            const FrameHeader& header,
+                                            std::vector<uint8_t>& data_vector);
 };
 #endif
@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#include "yolo-postprocess.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <map>
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/dnn.hpp>
+
+void YoloPostprocess::scan(const cv::Mat &out, float threshold, const cv::Size &frame_size,
+                           Candidates &candidates)
+{
+  CV_Assert(out.type() == CV_32F && out.cols > 5);
+  const int num_classes = out.cols - 5;
+  for(int j = 0; j < out.rows; ++j) {
+    const float *data = out.ptr<float>(j);
+    if(data[4] <= threshold) {
+      continue;
+    }
+
+    float confidence;
+    const int class_id = argmax(data + 5, num_classes, confidence);
+    if(confidence > threshold) {
+      const int centerX = static_cast<int>(data[0] * frame_size.width);
+      const int centerY = static_cast<int>(data[1] * frame_size.height);
+      const int width = static_cast<int>(data[2] * frame_size.width);
+      const int height = static_cast<int>(data[3] * frame_size.height);
+
+      candidates.class_ids.push_back(class_id);
+      candidates.confidences.push_back(confidence);
+      candidates.boxes.push_back(cv::Rect(centerX - width / 2, centerY - height / 2, width, height));
+    }
+  }
+}
+
+void YoloPostprocess::suppress(const Candidates &candidates, float threshold,
+                               float nms_threshold, std::vector<int> &indices)
+{
+  std::map<int, std::vector<int>> by_class;
+  for(size_t i = 0; i < candidates.class_ids.size(); ++i) {
+    by_class[candidates.class_ids[i]].push_back(static_cast<int>(i));
+  }
+
+  std::vector<cv::Rect> boxes;
+  std::vector<float> confidences;
+  std::vector<int> kept;
+  for(const auto &entry : by_class) {
+    const std::vector<int> &members = entry.second;
+    boxes.clear();
+    confidences.clear();
+    for(int index : members) {
+      boxes.push_back(candidates.boxes[index]);
+      confidences.push_back(candidates.confidences[index]);
+    }
+    kept.clear();
+    cv::dnn::NMSBoxes(boxes, confidences, threshold, nms_threshold, kept);
+    for(int k : kept) {
+      indices.push_back(members[k]);
+    }
+  }
+}
+
+int YoloPostprocess::argmax(const float *scores, int count, float &max_score)
+{
+  int i = 0;
+  int best = 0;
+  max_score = -FLT_MAX;
+#if CV_SIMD128
+  if(count >= 4) {
+    // Every lane tracks the first maximum of its own columns; the lanes are
+    // merged so that ties resolve to the lowest index, as minMaxLoc does.
+    cv::v_float32x4 v_max = cv::v_setall_f32(-FLT_MAX);
+    cv::v_int32x4 v_best = cv::v_setall_s32(0);
+    cv::v_int32x4 v_index(0, 1, 2, 3);
+    const cv::v_int32x4 v_step = cv::v_setall_s32(4);
+    for(; i + 4 <= count; i += 4) {
+      const cv::v_float32x4 v_scores = cv::v_load(scores + i);
+      const cv::v_float32x4 v_greater = v_scores > v_max;
+      v_max = cv::v_select(v_greater, v_scores, v_max);
+      v_best = cv::v_select(cv::v_reinterpret_as_s32(v_greater), v_index, v_best);
+      v_index += v_step;
+    }
+
+    float lane_max[4];
+    int lane_best[4];
+    cv::v_store(lane_max, v_max);
+    cv::v_store(lane_best, v_best);
+    for(int lane = 0; lane < 4; ++lane) {
+      if(lane_max[lane] > max_score ||
+         (lane_max[lane] == max_score && lane_best[lane] < best)) {
+        max_score = lane_max[lane];
+        best = lane_best[lane];
+      }
+    }
+  }
+#endif
+  for(; i < count; ++i) {
+    if(scores[i] > max_score) {
+      max_score = scores[i];
+      best = i;
+    }
+  }
+  return best;
+}
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+#ifndef YOLO_POSTPROCESS_HPP_INC
+#define YOLO_POSTPROCESS_HPP_INC
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// Turns the rows of YOLO region layer outputs into detections.
+//
+// Each row is [x, y, w, h, objectness, class scores...] relative to the
+// frame. The class scores are already scaled by the objectness, so a row
+// whose objectness is at or below the threshold cannot produce a detection
+// and its class scores are not looked at.
+class YoloPostprocess {
+ public:
+  struct Candidates {
+    std::vector<int> class_ids;
+    std::vector<float> confidences;
+    std::vector<cv::Rect> boxes;
+  };
+
+  YoloPostprocess() = delete;
+
+  // Appends the rows of out whose best class score exceeds threshold.
+  static void scan(const cv::Mat &out, float threshold, const cv::Size &frame_size,
+                   Candidates &candidates);
+  // Non-maximum suppression among candidates of the same class. Returns the
+  // indices of the kept candidates.
+  static void suppress(const Candidates &candidates, float threshold, float nms_threshold,
+                       std::vector<int> &indices);
+  // Index of the first maximum of scores[0..count); vectorized where the
+  // platform has 128-bit SIMD.
+  static int argmax(const float *scores, int count, float &max_score);
+};
+
+#endif
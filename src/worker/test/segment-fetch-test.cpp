@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2019 Osaka University
+ *
+ * This software is released under the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * @author Yoji Yamamoto
+ *
+ */
+// Fetches a cloud-mode frame of several segments end to end: the edge's
+// first Interest, the segment Interests SegmentFetcher derives from it and
+// the segments the worker names after it have to match, which they did not
+// while the frame request was carried in the Interest parameters.
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+
+#include <ndn-cxx/interest-filter.hpp>
+#include <ndn-cxx/lp/nack.hpp>
+#include <ndn-cxx/security/signing-helpers.hpp>
+#include <ndn-cxx/security/validator-null.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+#include <ndn-cxx/util/segment-fetcher.hpp>
+
+#include "frame-codec.hpp"
+#include "query-name.hpp"
+#include "segment-store.hpp"
+
+namespace {
+int failures = 0;
+
+void check(bool condition, const char *what)
+{
+  if(!condition) {
+    std::cerr << "FAILED: " << what << std::endl;
+    ++failures;
+  }
+}
+}  // namespace
+
+int main()
+{
+  boost::asio::io_service io;
+  ndn::util::DummyClientFace face(io);
+  ndn::KeyChain key_chain("pib-memory:", "tpm-memory:");
+  SegmentStore store{SegmentStore::Limits()};
+
+  const size_t segment_size = 1000;
+  std::vector<uint8_t> frame(4 * segment_size + 17);
+  for(size_t i = 0; i < frame.size(); ++i) {
+    frame[i] = static_cast<uint8_t>(i * 7);
+  }
+
+  FrameRequest request;
+  request.codec = FrameCodec::JPEG;
+  request.quality = 90;
+  request.width = 416;
+  request.height = 416;
+
+  // The worker, answering as Worker::onInterest does in cloud mode. The face
+  // loops Interests and Data back between the filter and the fetcher, and
+  // matches them as a forwarder would, parameters digest included.
+  size_t frame_requests = 0;
+  ndn::InterestFilter filter(QueryName::prefix("30321"));
+  filter.allowLoopback(true);
+  face.setInterestFilter(filter, [&](const ndn::InterestFilter &, const ndn::Interest &interest) {
+    const ndn::Name &name = interest.getName();
+    if(name.size() > 0 && name[-1].isSegment()) {
+      const ndn::Data *data = store.find(interest);
+      if(data != nullptr) {
+        face.put(*data);
+      } else {
+        face.put(ndn::lp::Nack(interest));
+      }
+      return;
+    }
+    ++frame_requests;
+    FrameRequest received;
+    check(!interest.hasApplicationParameters(), "the first Interest has no parameters");
+    check(FrameCodec::parse_request_key(
+              std::string(reinterpret_cast<const char *>(name[-1].value()), name[-1].value_size()),
+              received) &&
+              received.codec == request.codec && received.quality == request.quality &&
+              received.width == request.width && received.height == request.height,
+          "the frame request is read from the name");
+
+    const ndn::Name versioned_prefix = ndn::Name(name).appendVersion(1);
+    SegmentStore::segments_type segments =
+        SegmentStore::segment(versioned_prefix, frame.data(), frame.size(), segment_size,
+                              key_chain, ndn::security::signingWithSha256());
+    const std::shared_ptr<ndn::Data> first = segments.front();
+    store.insert(versioned_prefix, std::move(segments));
+    face.put(*first);
+  });
+
+  // The edge, naming the fetch as Producer::processInterest_Cloud does.
+  ndn::Name name(QueryName::forward("#f:detect", "30321", 42));
+  name.append(FrameCodec::request_key(request));
+  ndn::Interest interest(name);
+  interest.setCanBePrefix(true);
+  interest.setMustBeFresh(true);
+
+  bool is_complete = false;
+  size_t received_segments = 0;
+  auto fetcher = ndn::util::SegmentFetcher::start(face, interest,
+                                                  ndn::security::v2::getAcceptAllValidator());
+  fetcher->afterSegmentReceived.connect([&](const ndn::Data &) { ++received_segments; });
+  fetcher->onComplete.connect([&](ndn::ConstBufferPtr data) {
+    is_complete = true;
+    check(data->size() == frame.size() && std::equal(frame.begin(), frame.end(), data->begin()),
+          "the reassembled frame equals the sent one");
+  });
+  fetcher->onError.connect([&](uint32_t code, const std::string &message) {
+    std::cerr << "Fetch error " << code << ": " << message << std::endl;
+    is_complete = true;
+  });
+
+  for(int i = 0; i < 10000 && !is_complete; ++i) {
+    io.poll();
+    io.reset();
+  }
+
+  check(is_complete, "the fetch completes");
+  check(received_segments == 5, "all 5 segments are received");
+  check(frame_requests == 1, "the frame is encoded once");
+
+  if(failures != 0) {
+    return EXIT_FAILURE;
+  }
+  std::cerr << "segment-fetch-test: OK" << std::endl;
+  return EXIT_SUCCESS;
+}